@@ -75,7 +75,7 @@
 #include "Tools.h"
 #include "SeedsRevised.h"
 #include "FeatureType.h"
-#include "ContourRelaxation.h"
+#include "StaticContourRelaxation.h"
 #include "InitializationFunctions.h"
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
@@ -194,8 +194,9 @@ int main(int argc, const char** argv) {
 
         enabledFeatures.push_back(Compactness);
         
-        ContourRelaxation<boost::uint16_t> contourRelaxationInst(enabledFeatures);
-        contourRelaxationInst.setCompactnessData(compactness);
+        boost::shared_ptr< AContourRelaxation<boost::uint16_t> > contourRelaxationInst
+                = createContourRelaxation<boost::uint16_t>(enabledFeatures);
+        contourRelaxationInst->setCompactnessData(compactness);
         
         cv::Mat labelImage = createBlockInitialization<boost::uint16_t>(image.size(), width, height);
         
@@ -205,13 +206,13 @@ int main(int argc, const char** argv) {
             std::vector<cv::Mat> imageYCrCbChannels;
             cv::split(imageYCrCb, imageYCrCbChannels);
 
-            contourRelaxationInst.setColorData(imageYCrCbChannels[0], imageYCrCbChannels[1], imageYCrCbChannels[2]);
+            contourRelaxationInst->setColorData(imageYCrCbChannels[0], imageYCrCbChannels[1], imageYCrCbChannels[2]);
         }
         else {
             cv::Mat imageGray = image.clone();
             cv::cvtColor(imageGray, image, SEEDS_REVISED_OPENCV_GRAY2BGR);
 
-            contourRelaxationInst.setGrayvalueData(imageGray);
+            contourRelaxationInst->setGrayvalueData(imageGray);
         }
 
         cv::Mat relaxedLabelImage;
@@ -220,7 +221,7 @@ int main(int argc, const char** argv) {
         timer.restart();
         int index = std::distance(images.begin(), iterator);
         
-        contourRelaxationInst.relax(labelImage, directCost, diagonalCost, iterations, relaxedLabelImage, regionMeanImage);
+        contourRelaxationInst->relax(labelImage, directCost, diagonalCost, iterations, relaxedLabelImage, regionMeanImage);
         
         time.at<double>(index, 1) = timer.elapsed();
         time.at<double>(index, 0) = index + 1;
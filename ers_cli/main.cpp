@@ -25,10 +25,31 @@
  *   --sigma arg (=5)         sigma
  *   --four-connected         use 4-connected
  *   --superpixels arg (=400) number of superpixels
+ *   --heap-arity arg (=2)    children of each heap node, 2 or 4 (faster)
+ *   --coarsen arg (=0)       cluster atoms of neighbouring pixels with a color 
+ *                            distance below the given one instead of pixels 
+ *                            (faster, 0 to disable)
+ *   --atom-size arg (=16)    maximum number of pixels of an atom
+ *   --compact                store only float edge weights (less memory)
+ *   --tiles arg (=1)         cluster arg x arg tiles of the image in parallel 
+ *                            before merging across them (faster on several 
+ *                            cores, fewer tiles if they would be smaller than 
+ *                            8x8 pixels)
+ *   --tolerance arg (=0)     merge edges whose gain is within the given 
+ *                            fraction of the best one (faster, e.g. 0.001, 0 
+ *                            for the exact algorithm)
  *   --time arg               time the algorithm and save results to the given 
  *                            directory
  *   --process                show additional information while processing
  *   --csv                    save segmentation as CSV file
+ *   --hierarchy arg          save the segmentations with the given numbers of 
+ *                            superpixels as CSV files (name_<superpixels>.csv) 
+ *                            from one run down to the smallest number
+ *   --tree                   save the merge tree in binary form (name.tree)
+ *   --convert arg            convert the graph in the given text file to the 
+ *                            binary format (name.graph in the output 
+ *                            directory, float weights with --compact) instead 
+ *                            of processing images
  *   --contour                save contour image of segmentation
  *   --mean                   save mean colored image of segmentation
  *   --output arg (=output)   specify the output directory (default is ./output)
@@ -66,13 +87,16 @@
 #include "MERCLazyGreedy.h"
 #include "MERCInputImage.h"
 #include "MERCOutputImage.h"
+#include "MERCMergeTree.h"
+#include "MERCInputCoarse.h"
 #include "Image.h"
 #include "ImageIO.h"
 #include "Tools.h"
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/timer.hpp>
 #include <boost/program_options.hpp>
+#include <boost/lexical_cast.hpp>
+#include <chrono>
 
 #if defined(WIN32) || defined(_WIN32)
     #define DIRECTORY_SEPARATOR "\\"
@@ -90,9 +114,18 @@ int main(int argc, const char** argv) {
         ("sigma", boost::program_options::value<double>()->default_value(5.0), "sigma")
         ("four-connected", "use 4-connected")
         ("superpixels", boost::program_options::value<int>()->default_value(400), "number of superpixels")
+        ("heap-arity", boost::program_options::value<int>()->default_value(2), "children of each heap node, 2 or 4 (faster)")
+        ("coarsen", boost::program_options::value<double>()->default_value(0), "cluster atoms of neighbouring pixels with a color distance below the given one instead of pixels (faster, 0 to disable)")
+        ("atom-size", boost::program_options::value<int>()->default_value(16), "maximum number of pixels of an atom")
+        ("compact", "store only float edge weights (less memory)")
+        ("tiles", boost::program_options::value<int>()->default_value(1), "cluster arg x arg tiles of the image in parallel before merging across them (faster on several cores, fewer tiles if they would be smaller than 8x8 pixels)")
+        ("tolerance", boost::program_options::value<double>()->default_value(0), "merge edges whose gain is within the given fraction of the best one (faster, e.g. 0.001, 0 for the exact algorithm)")
         ("time", boost::program_options::value<std::string>(), "time the algorithm and save results to the given directory")
         ("process", "show additional information while processing")
         ("csv", "save segmentation as CSV file")
+        ("hierarchy", boost::program_options::value< std::vector<int> >()->multitoken(), "save the segmentations with the given numbers of superpixels as CSV files (name_<superpixels>.csv) from one run down to the smallest number")
+        ("tree", "save the merge tree in binary form (name.tree)")
+        ("convert", boost::program_options::value<std::string>(), "convert the graph in the given text file to the binary format (name.graph in the output directory, float weights with --compact) instead of processing images")
         ("contour", "save contour image of segmentation")
         ("mean", "save mean colored image of segmentation")
         ("output", boost::program_options::value<std::string>()->default_value("output"), "specify the output directory (default is ./output)");
@@ -114,6 +147,25 @@ int main(int argc, const char** argv) {
         boost::filesystem::create_directory(outputDir);
     }
     
+    // The binary graph can be memory mapped by MERCInput::ReadBinary instead
+    // of parsing the text.
+    if (parameters.find("convert") != parameters.end()) {
+        boost::filesystem::path graphFile(parameters["convert"].as<std::string>());
+        std::string store = outputDir.string() + DIRECTORY_SEPARATOR + graphFile.stem().string() + ".graph";
+        
+        int weightType = MERCInput::DOUBLE_WEIGHTS;
+        if (parameters.find("compact") != parameters.end()) {
+            weightType = MERCInput::FLOAT_WEIGHTS;
+        }
+        
+        if (!MERCInput::ConvertToBinary(graphFile.string().c_str(), store.c_str(), weightType)) {
+            return 1;
+        }
+        
+        std::cout << "Graph " << graphFile.string() << " saved in " << store << " ..." << std::endl;
+        return 0;
+    }
+    
     boost::filesystem::path inputDir(parameters["input"].as<std::string>());
     if (!boost::filesystem::is_directory(inputDir)) {
         std::cout << "Image directory not found ..." << std::endl;
@@ -156,7 +208,9 @@ int main(int argc, const char** argv) {
     
     std::cout << count << " images total ..." << std::endl;
     
-    boost::timer timer;
+    // Wall clock time: the graph, the normalization and the tiles are computed
+    // by several threads, whose CPU times would add up.
+    std::chrono::steady_clock::time_point start;
     double totalTime = 0;
     
     int eightConnected = 1;
@@ -168,36 +222,87 @@ int main(int argc, const char** argv) {
     int kernel = 0;
     double lambda = parameters["lambda"].as<double>();
     double sigma = parameters["sigma"].as<double>();
+    double coarsen = parameters["coarsen"].as<double>();
+    int atomSize = parameters["atom-size"].as<int>();
+    bool compact = parameters.find("compact") != parameters.end();
+    int heapArity = parameters["heap-arity"].as<int>();
+    if (heapArity != 2 && heapArity != 4) {
+        std::cout << "Heap arity must be 2 or 4 ..." << std::endl;
+        return 1;
+    }
+    int tiles = parameters["tiles"].as<int>();
+    if (tiles < 1) {
+        std::cout << "Number of tiles must be at least 1 ..." << std::endl;
+        return 1;
+    }
+    
     MERCLazyGreedy merc;
+    merc.SetHeapArity(heapArity);
+    merc.SetTolerance(parameters["tolerance"].as<double>());
+    
+    std::vector<int> hierarchy;
+    if (parameters.find("hierarchy") != parameters.end()) {
+        hierarchy = parameters["hierarchy"].as< std::vector<int> >();
+    }
+    
+    // With a hierarchy, all segmentations including the one with the given
+    // number of superpixels are taken from the merge tree of one run.
+    int clusters = superpixels;
+    int maxClusters = superpixels;
+    for (unsigned int i = 0; i < hierarchy.size(); ++i) {
+        clusters = std::min(clusters, hierarchy[i]);
+        maxClusters = std::max(maxClusters, hierarchy[i]);
+    }
+    
+    // The tiles stop at the largest requested number of superpixels or above,
+    // as the merge tree is only balanced below the clusters they leave.
+    merc.SetTiles(tiles, tiles, std::max(3.0, maxClusters*1.0/clusters));
+    
+    MERCMergeTree tree;
+    if (!hierarchy.empty() || parameters.find("tree") != parameters.end()) {
+        merc.SetMergeTree(&tree);
+    }
     
     cv::Mat time(images.size(), 2, cv::DataType<double>::type);
     for(std::vector<boost::filesystem::path>::iterator iterator = images.begin(); iterator != images.end(); ++iterator) {
         cv::Mat mat = cv::imread(iterator->string());
         
-        Image<RGBMap> inputImage;
         MERCInputImage<RGBMap> input;
 
-        inputImage.Resize(mat.cols, mat.rows, false);
-
-        for (int i = 0; i < mat.rows; ++i) {
-            for (int j = 0; j < mat.cols; ++j) {
-                RGBMap color((int) mat.at<cv::Vec3b>(i, j)[2], (int) mat.at<cv::Vec3b>(i, j)[1], (int) mat.at<cv::Vec3b>(i, j)[0]);
-                inputImage.Access(j, i) = color;
-            }
-        }
-
-        input.ReadImage(&inputImage, eightConnected);
-		
-        timer.restart();
+        start = std::chrono::steady_clock::now();
         int index = std::distance(images.begin(), iterator);
         
-        merc.ClusteringTreeIF(input.nNodes_, input, kernel, sigma*mat.channels(), lambda*1.0*superpixels, superpixels);
+        // The graph is built from the BGR bytes of the image, the distance
+        // does not depend on the order of the channels.
+        input.ReadImage(mat.data, mat.cols, mat.rows, mat.step, mat.channels(), eightConnected, sigma*mat.channels(), compact);
         
-        time.at<double>(index, 1) = timer.elapsed();
+        // Contract pixels closer than the color distance given by --coarsen,
+        // the threshold is on the similarity of the distance.
+        MERCInputCoarse coarse;
+        MERCInput* graph = &input;
+        if (coarsen > 0) {
+            double twoSigmaSquare = 2*sigma*mat.channels()*sigma*mat.channels();
+            coarse.Coarsen(input, std::exp(-(coarsen*coarsen)/twoSigmaSquare), atomSize);
+            graph = &coarse;
+        }
+        
+        merc.ClusteringTreeIF(graph->nNodes_, *graph, kernel, sigma*mat.channels(), lambda*1.0*clusters, clusters);
+        
+        time.at<double>(index, 1) = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
         time.at<double>(index, 0) = index + 1;
         totalTime += time.at<double>(index, 1);
         
-	vector<int> label = MERCOutputImage::DisjointSetToLabel(merc.disjointSet_);
+        vector<int> label;
+        if (hierarchy.empty()) {
+            label = MERCOutputImage::DisjointSetToLabel(merc.disjointSet_);
+        }
+        else {
+            label = tree.Label(superpixels);
+        }
+        
+        if (coarsen > 0) {
+            label = coarse.FineLabel(label);
+        }
         
         int** labels = new int*[mat.rows];
         for (int i = 0; i < mat.rows; ++i) {
@@ -248,6 +353,40 @@ int main(int argc, const char** argv) {
             }
         }
         
+        for (unsigned int k = 0; k < hierarchy.size(); ++k) {
+            
+            label = tree.Label(hierarchy[k]);
+            if (coarsen > 0) {
+                label = coarse.FineLabel(label);
+            }
+            
+            for (int i = 0; i < mat.rows; ++i) {
+                for (int j = 0; j < mat.cols; ++j) {
+                    labels[i][j] = label[j + i*mat.cols];
+                }
+            }
+            
+            Integrity::relabel(labels, mat.rows, mat.cols);
+            
+            boost::filesystem::path csvFile(outputDir.string() + DIRECTORY_SEPARATOR + iterator->filename().string().substr(0, position) 
+                    + "_" + boost::lexical_cast<std::string>(hierarchy[k]) + ".csv");
+            Export::CSV(labels, mat.rows, mat.cols, csvFile);
+            
+            if (process == true) {
+                std::cout << "Labels for image " << iterator->string() << " with " << hierarchy[k] << " superpixels saved in " << csvFile.string() << " ..." << std::endl;
+            }
+        }
+        
+        if (parameters.find("tree") != parameters.end()) {
+            
+            std::string store = outputDir.string() + DIRECTORY_SEPARATOR + iterator->filename().string().substr(0, position) + ".tree";
+            tree.Write(store.c_str());
+            
+            if (process == true) {
+                std::cout << "Merge tree for image " << iterator->string() << " saved in " << store << " ..." << std::endl;
+            }
+        }
+        
         for (int i = 0; i < mat.rows; ++i) {
             delete[] labels[i];
         }
@@ -39,14 +39,19 @@ class AGaussianFeature : public IFeature<TLabelImage>
         void updateGaussianStatistics(cv::Point2i const& curPixelCoords, LabelStatisticsGauss& labelStatsOldLabel,
             LabelStatisticsGauss& labelStatsNewLabel, cv::Mat const& data) const;
 
+        template <typename TData>
+        void updateGaussianStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& newLabel,
+            std::vector<LabelStatisticsGauss>& labelStatistics, std::vector<double>& labelCosts, cv::Mat const& data) const;
+
         template <typename TData>
         void initializeGaussianStatistics(cv::Mat const& labelImage, cv::Mat const& data,
-            std::vector<LabelStatisticsGauss>& out_labelStatistics) const;
+            std::vector<LabelStatisticsGauss>& out_labelStatistics, std::vector<double>& out_labelCosts) const;
+
+        double calculateGaussianLabelCost(LabelStatisticsGauss const& labelStats) const;
 
         template <typename TData>
-        double calculateGaussianCost(cv::Point2i const& curPixelCoords,
-            TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels,
-            std::vector<LabelStatisticsGauss> const& labelStatistics, cv::Mat const& data) const;
+        double calculateGaussianCost(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& pretendLabel,
+            std::vector<LabelStatisticsGauss> const& labelStatistics, std::vector<double> const& labelCosts, cv::Mat const& data) const;
 
 
     public:
@@ -87,16 +92,40 @@ void AGaussianFeature<TLabelImage>::updateGaussianStatistics(cv::Point2i const&
 }
 
 
+/**
+ * @brief Update the saved label statistics and costs of a Gaussian distribution to reflect a label change of the given pixel.
+ * @param curPixelCoords coordinates of the pixel whose label changes
+ * @param oldLabel old label of the changing pixel
+ * @param newLabel new label of the changing pixel
+ * @param labelStatistics label statistics of all labels in the image (the ones of oldLabel and newLabel will be updated)
+ * @param labelCosts cost of each label as given by calculateGaussianLabelCost (the ones of oldLabel and newLabel will be updated)
+ * @param data observed data of the distribution whose statistics are being modelled
+ */
+template <typename TLabelImage>
+template <typename TData>
+void AGaussianFeature<TLabelImage>::updateGaussianStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
+    TLabelImage const& newLabel, std::vector<LabelStatisticsGauss>& labelStatistics, std::vector<double>& labelCosts,
+    cv::Mat const& data) const
+{
+    updateGaussianStatistics<TData>(curPixelCoords, labelStatistics[oldLabel], labelStatistics[newLabel], data);
+
+    // Only the costs of the two changed labels need to be computed again.
+    labelCosts[oldLabel] = calculateGaussianLabelCost(labelStatistics[oldLabel]);
+    labelCosts[newLabel] = calculateGaussianLabelCost(labelStatistics[newLabel]);
+}
+
+
 /**
  * @brief Estimate the statistics of a Gaussian distribution for each label on the given observed data.
  * @param labelImage contains the label identifier to which each pixel is assigned
  * @param data observed data of the Gaussian distributions
  * @param out_labelStatistics will be created and contain the label statistics of all labels in labelImage
+ * @param out_labelCosts will be created and contain the cost of each label as given by calculateGaussianLabelCost
  */
 template <typename TLabelImage>
 template <typename TData>
 void AGaussianFeature<TLabelImage>::initializeGaussianStatistics(cv::Mat const& labelImage, cv::Mat const& data,
-    std::vector<LabelStatisticsGauss>& out_labelStatistics) const
+    std::vector<LabelStatisticsGauss>& out_labelStatistics, std::vector<double>& out_labelCosts) const
 {
     assert(labelImage.size() == data.size());
     assert(labelImage.type() == cv::DataType<TLabelImage>::type);
@@ -133,89 +162,87 @@ void AGaussianFeature<TLabelImage>::initializeGaussianStatistics(cv::Mat const&
             out_labelStatistics[curLabel].squareValueSum += pow(static_cast<double>(dataRowPtr[col]), 2.0);
         }
     }
+
+    // Compute the cost of each label, which will be kept up to date with the statistics.
+    out_labelCosts = std::vector<double>(out_labelStatistics.size());
+
+    for (std::vector<double>::size_type curLabel = 0; curLabel < out_labelCosts.size(); ++curLabel)
+    {
+        out_labelCosts[curLabel] = calculateGaussianLabelCost(out_labelStatistics[curLabel]);
+    }
 }
 
 
 /**
- * @brief Calculate the total cost of all labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
+ * @brief Calculate the cost of a label, i.e. the negative log-likelihood of its pixels under its Gaussian distribution.
+ * @param labelStats statistics of the label
+ * @return the cost of the label, 0 for a label without pixels
+ */
+template <typename TLabelImage>
+double AGaussianFeature<TLabelImage>::calculateGaussianLabelCost(LabelStatisticsGauss const& labelStats) const
+{
+    // If a label completely vanished, disregard it (can happen to old label of pixel_index).
+    if (labelStats.pixelCount == 0)
+    {
+        return 0;
+    }
+
+    // Compute the variance of the Gaussian distribution of the label.
+    // Cast the numerator of both divisions to double so that we get double precision in the result,
+    // because the statistics are most likely stored as integers.
+    double variance = (labelStats.squareValueSum / labelStats.pixelCount)
+        - pow(labelStats.valueSum / labelStats.pixelCount, 2.0);
+
+    // Ensure variance is bigger than zero, else we could get -infinity
+    // cost which screws up everything. Could happen to labels with only
+    // a few pixels which all have the exact same grayvalue (or a label
+    // with just one pixel).
+    variance = std::max(variance, featuresMinVariance);
+
+    return (static_cast<double>(labelStats.pixelCount) / 2 * log(2 * M_PI * variance))
+        + (static_cast<double>(labelStats.pixelCount) / 2);
+}
+
+
+/**
+ * @brief Calculate the change in cost of the labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
  * @param curPixelCoords coordinates of the regarded pixel
  * @param oldLabel old label of the regarded pixel
  * @param pretendLabel assumed new label of the regarded pixel
- * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
  * @param labelStatistics label statistics of all labels in the image
+ * @param labelCosts cost of each label as given by calculateGaussianLabelCost
  * @param data observed data of the modelled Gaussian distributions
- * @return total negative log-likelihood (or cost) of all labels in the neighbourhood, assuming the label change
+ * @return change in the total negative log-likelihood (or cost) of all labels in the neighbourhood by the label change
+ *
+ * Only the old and the pretended label change, so the costs of all other labels in the neighbourhood
+ * drop out. Relative to keeping the old label, this is the same for every pretended label, so the label
+ * of minimum cost is the same as for the total cost.
  */
 template <typename TLabelImage>
 template <typename TData>
 double AGaussianFeature<TLabelImage>::calculateGaussianCost(cv::Point2i const& curPixelCoords,
-    TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels,
-    std::vector<LabelStatisticsGauss> const& labelStatistics, cv::Mat const& data) const
+    TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<LabelStatisticsGauss> const& labelStatistics,
+    std::vector<double> const& labelCosts, cv::Mat const& data) const
 {
     assert(curPixelCoords.inside(cv::Rect(0, 0, data.cols, data.rows)));
     assert(data.type() == cv::DataType<TData>::type);
 
-    // Modify the label statistics if the pixel at curPixelCoords has another
-    // label than pretendLabel. We only modify a local copy of the statistics,
-    // however, since we do not actually want to change a label yet. We are
-    // just calculating the cost of doing so.
-    // We only copy the affected statistics, namely the ones of the old and the
-    // new (pretend) label. We have to handle these two cases separately when accessing
-    // the statistics, because we specifically need to access the local, modified versions.
-    // But we save a lot of time since we do not need to create a copy of all statistics.
-    LabelStatisticsGauss labelStatsOldLabel(labelStatistics[oldLabel]);
-    LabelStatisticsGauss labelStatsPretendLabel(labelStatistics[pretendLabel]);
-
-    if (oldLabel != pretendLabel)
+    // Keeping the old label changes nothing.
+    if (oldLabel == pretendLabel)
     {
-        updateGaussianStatistics<TData>(curPixelCoords, labelStatsOldLabel, labelStatsPretendLabel, data);
+        return 0;
     }
 
-    double featureCost = 0;
-
-    // For each neighbouring label, add its cost.
-    for (typename std::vector<TLabelImage>::const_iterator it_neighbourLabel = neighbourLabels.begin();
-        it_neighbourLabel != neighbourLabels.end(); ++it_neighbourLabel)
-    {
-        // Get a pointer to the label statistics of the current label.
-        // This should be the associated entry in the vector of label statistics, except for the
-        // special cases below.
-        LabelStatisticsGauss const* curLabelStats = &labelStatistics[*it_neighbourLabel];
-
-        // If the current label is the old one at curPixelCoords, or the pretended new one,
-        // then its statistics have changed. In this case, we need to read the statistics
-        // from the modified local variables.
-        if (*it_neighbourLabel == oldLabel)
-        {
-            curLabelStats = &labelStatsOldLabel;
-        }
-        else if (*it_neighbourLabel == pretendLabel)
-        {
-            curLabelStats = &labelStatsPretendLabel;
-        }
-
-        // If a label completely vanished, disregard it (can happen to old label of pixel_index).
-        if (curLabelStats->pixelCount == 0)
-        {
-            continue;
-        }
+    // Modify the statistics of the old and the new (pretend) label as if the pixel at
+    // curPixelCoords had changed its label. We only modify local copies of the statistics,
+    // however, since we do not actually want to change a label yet. We are just calculating
+    // the cost of doing so.
+    LabelStatisticsGauss labelStatsOldLabel(labelStatistics[oldLabel]);
+    LabelStatisticsGauss labelStatsPretendLabel(labelStatistics[pretendLabel]);
 
-        // Compute the variance of the Gaussian distribution of the current label.
-        // Cast the numerator of both divisions to double so that we get double precision in the result,
-        // because the statistics are most likely stored as integers.
-        double variance = (curLabelStats->squareValueSum / curLabelStats->pixelCount)
-            - pow(curLabelStats->valueSum / curLabelStats->pixelCount, 2.0);
-
-        // Ensure variance is bigger than zero, else we could get -infinity
-        // cost which screws up everything. Could happen to labels with only
-        // a few pixels which all have the exact same grayvalue (or a label
-        // with just one pixel).
-        variance = std::max(variance, featuresMinVariance);
-
-        // Add the cost of the current region.
-        featureCost += (static_cast<double>(curLabelStats->pixelCount) / 2 * log(2 * M_PI * variance))
-            + (static_cast<double>(curLabelStats->pixelCount) / 2);
-    }
+    updateGaussianStatistics<TData>(curPixelCoords, labelStatsOldLabel, labelStatsPretendLabel, data);
 
-    return featureCost;
+    // Compare the costs of both labels after the change to the saved costs before the change.
+    return (calculateGaussianLabelCost(labelStatsOldLabel) - labelCosts[oldLabel])
+        + (calculateGaussianLabelCost(labelStatsPretendLabel) - labelCosts[pretendLabel]);
 }
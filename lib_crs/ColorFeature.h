@@ -41,6 +41,9 @@ class ColorFeature : public AGaussianFeature<TLabelImage>
         std::vector<LabelStatisticsGauss> labelStatisticsChan1; ///< Gaussian label statistics of the first channel
         std::vector<LabelStatisticsGauss> labelStatisticsChan2; ///< Gaussian label statistics of the second channel
         std::vector<LabelStatisticsGauss> labelStatisticsChan3; ///< Gaussian label statistics of the third channel
+        std::vector<double> labelCostsChan1; ///< cost of each label on the first channel
+        std::vector<double> labelCostsChan2; ///< cost of each label on the second channel
+        std::vector<double> labelCostsChan3; ///< cost of each label on the third channel
         cv::Mat channel1; ///< observed data of the first channel
         cv::Mat channel2; ///< observed data of the second channel
         cv::Mat channel3; ///< observed data of the third channel
@@ -90,19 +93,19 @@ template <typename TLabelImage>
 void ColorFeature<TLabelImage>::initializeStatistics(cv::Mat const& labelImage)
 {
     // Use the provided initialization method for gaussian statistics from AGaussianFeature.
-    this->template initializeGaussianStatistics<TColorData>(labelImage, channel1, labelStatisticsChan1);
-    this->template initializeGaussianStatistics<TColorData>(labelImage, channel2, labelStatisticsChan2);
-    this->template initializeGaussianStatistics<TColorData>(labelImage, channel3, labelStatisticsChan3);
+    this->template initializeGaussianStatistics<TColorData>(labelImage, channel1, labelStatisticsChan1, labelCostsChan1);
+    this->template initializeGaussianStatistics<TColorData>(labelImage, channel2, labelStatisticsChan2, labelCostsChan2);
+    this->template initializeGaussianStatistics<TColorData>(labelImage, channel3, labelStatisticsChan3, labelCostsChan3);
 }
 
 
 /**
- * @brief Calculate the total cost of all labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
+ * @brief Calculate the change in cost of the labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
  * @param curPixelCoords coordinates of the regarded pixel
  * @param oldLabel old label of the regarded pixel
  * @param pretendLabel assumed new label of the regarded pixel
  * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
- * @return total negative log-likelihood (or cost) of all labels in the neighbourhood, assuming the label change
+ * @return change in the total negative log-likelihood (or cost) of all labels in the neighbourhood by the label change
  */
 template <typename TLabelImage>
 double ColorFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelCoords,
@@ -110,11 +113,11 @@ double ColorFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelCoord
 {
     // Use the provided cost calculation method for gaussian statistics from AGaussianFeature.
     double cost = this->template calculateGaussianCost<TColorData>(curPixelCoords, oldLabel, pretendLabel,
-            neighbourLabels, labelStatisticsChan1, channel1)
+            labelStatisticsChan1, labelCostsChan1, channel1)
         + this->template calculateGaussianCost<TColorData>(curPixelCoords, oldLabel, pretendLabel,
-            neighbourLabels, labelStatisticsChan2, channel2)
+            labelStatisticsChan2, labelCostsChan2, channel2)
         + this->template calculateGaussianCost<TColorData>(curPixelCoords, oldLabel, pretendLabel,
-            neighbourLabels, labelStatisticsChan3, channel3);
+            labelStatisticsChan3, labelCostsChan3, channel3);
 
     return cost;
 }
@@ -131,12 +134,12 @@ void ColorFeature<TLabelImage>::updateStatistics(cv::Point2i const& curPixelCoor
     TLabelImage const& newLabel)
 {
     // Use the provided update method for gaussian statistics from AGaussianFeature.
-    this->template updateGaussianStatistics<TColorData>(curPixelCoords, labelStatisticsChan1[oldLabel],
-        labelStatisticsChan1[newLabel], channel1);
-    this->template updateGaussianStatistics<TColorData>(curPixelCoords, labelStatisticsChan2[oldLabel],
-        labelStatisticsChan2[newLabel], channel2);
-    this->template updateGaussianStatistics<TColorData>(curPixelCoords, labelStatisticsChan3[oldLabel],
-        labelStatisticsChan3[newLabel], channel3);
+    this->template updateGaussianStatistics<TColorData>(curPixelCoords, oldLabel, newLabel,
+        labelStatisticsChan1, labelCostsChan1, channel1);
+    this->template updateGaussianStatistics<TColorData>(curPixelCoords, oldLabel, newLabel,
+        labelStatisticsChan2, labelCostsChan2, channel2);
+    this->template updateGaussianStatistics<TColorData>(curPixelCoords, oldLabel, newLabel,
+        labelStatisticsChan3, labelCostsChan3, channel3);
 }
 
 
@@ -28,6 +28,7 @@ class DepthFeature : public AGaussianFeature<TLabelImage>
         typedef unsigned short TDepthData; ///< the type of the used image channels
 
         std::vector<LabelStatisticsGauss> labelStatistics; ///< Gaussian label statistics of the first channel
+        std::vector<double> labelCosts; ///< cost of each label on the first channel
         cv::Mat depth; ///< observed data of the first channel
 
 
@@ -69,17 +70,17 @@ template <typename TLabelImage>
 void DepthFeature<TLabelImage>::initializeStatistics(cv::Mat const& labelImage)
 {
     // Use the provided initialization method for gaussian statistics from AGaussianFeature.
-    this->template initializeGaussianStatistics<TDepthData>(labelImage, depth, labelStatistics);
+    this->template initializeGaussianStatistics<TDepthData>(labelImage, depth, labelStatistics, labelCosts);
 }
 
 
 /**
- * @brief Calculate the total cost of all labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
+ * @brief Calculate the change in cost of the labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
  * @param curPixelCoords coordinates of the regarded pixel
  * @param oldLabel old label of the regarded pixel
  * @param pretendLabel assumed new label of the regarded pixel
  * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
- * @return total negative log-likelihood (or cost) of all labels in the neighbourhood, assuming the label change
+ * @return change in the total negative log-likelihood (or cost) of all labels in the neighbourhood by the label change
  */
 template <typename TLabelImage>
 double DepthFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelCoords,
@@ -87,7 +88,7 @@ double DepthFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelCoord
 {
     // Use the provided cost calculation method for gaussian statistics from AGaussianFeature.
     double cost = this->template calculateGaussianCost<TDepthData>(curPixelCoords, oldLabel, pretendLabel,
-            neighbourLabels, this->labelStatistics, this->depth);
+            this->labelStatistics, this->labelCosts, this->depth);
 
     return cost;
 }
@@ -103,8 +104,8 @@ template <typename TLabelImage>
 void DepthFeature<TLabelImage>::updateStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel,
     TLabelImage const& newLabel)
 {
-    this->template updateGaussianStatistics<TDepthData>(curPixelCoords, this->labelStatistics[oldLabel],
-        this->labelStatistics[newLabel], this->depth);
+    this->template updateGaussianStatistics<TDepthData>(curPixelCoords, oldLabel, newLabel,
+        this->labelStatistics, this->labelCosts, this->depth);
 }
 
 
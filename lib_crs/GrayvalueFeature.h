@@ -39,6 +39,7 @@ class GrayvalueFeature : public AGaussianFeature<TLabelImage>
         typedef uchar TGrayvalueData; ///< the type of the used grayvalue images
 
         std::vector<LabelStatisticsGauss> labelStatistics; ///< Gaussian label statistics of the grayvalue image
+        std::vector<double> labelCosts; ///< cost of each label on the grayvalue image
         cv::Mat grayvalImage; ///< the observed grayvalue data
 
 
@@ -78,17 +79,17 @@ template <typename TLabelImage>
 void GrayvalueFeature<TLabelImage>::initializeStatistics(cv::Mat const& labelImage)
 {
     // Use the provided initialization method for gaussian statistics from AGaussianFeature.
-    this->template initializeGaussianStatistics<TGrayvalueData>(labelImage, grayvalImage, labelStatistics);
+    this->template initializeGaussianStatistics<TGrayvalueData>(labelImage, grayvalImage, labelStatistics, labelCosts);
 }
 
 
 /**
- * @brief Calculate the total cost of all labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
+ * @brief Calculate the change in cost of the labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
  * @param curPixelCoords coordinates of the regarded pixel
  * @param oldLabel old label of the regarded pixel
  * @param pretendLabel assumed new label of the regarded pixel
  * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
- * @return total negative log-likelihood (or cost) of all labels in the neighbourhood, assuming the label change
+ * @return change in the total negative log-likelihood (or cost) of all labels in the neighbourhood by the label change
  */
 template <typename TLabelImage>
 double GrayvalueFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelCoords,
@@ -96,7 +97,7 @@ double GrayvalueFeature<TLabelImage>::calculateCost(cv::Point2i const& curPixelC
 {
     // Use the provided cost calculation method for gaussian statistics from AGaussianFeature.
     return this->template calculateGaussianCost<TGrayvalueData>(curPixelCoords, oldLabel, pretendLabel,
-        neighbourLabels, labelStatistics, grayvalImage);
+        labelStatistics, labelCosts, grayvalImage);
 }
 
 
@@ -111,8 +112,8 @@ void GrayvalueFeature<TLabelImage>::updateStatistics(cv::Point2i const& curPixel
     TLabelImage const& newLabel)
 {
     // Use the provided update method for gaussian statistics from AGaussianFeature.
-    this->template updateGaussianStatistics<TGrayvalueData>(curPixelCoords, labelStatistics[oldLabel],
-        labelStatistics[newLabel], grayvalImage);
+    this->template updateGaussianStatistics<TGrayvalueData>(curPixelCoords, oldLabel, newLabel,
+        labelStatistics, labelCosts, grayvalImage);
 }
 
 
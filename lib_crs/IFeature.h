@@ -48,6 +48,9 @@ class IFeature
          * @param pretendLabel assumed new label of the regarded pixel
          * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
          * @return total negative log-likelihood (or cost) of all labels in the neighbourhood, assuming the label change
+         *
+         * Only the label with the minimum cost is used, so the cost may be offset by any amount which is the same for all
+         * pretended labels of the pixel, e.g. given as the change in cost relative to keeping the old label.
          */
         virtual double calculateCost(cv::Point2i const& curPixelCoords,
                                      TLabelImage const& oldLabel, TLabelImage const& pretendLabel,
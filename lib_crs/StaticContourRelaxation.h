@@ -0,0 +1,364 @@
+// Copyright 2013 Visual Sensorics and Information Processing Lab, Goethe University, Frankfurt
+//
+// This file is part of Contour-relaxed Superpixels.
+//
+// Contour-relaxed Superpixels is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Contour-relaxed Superpixels is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Contour-relaxed Superpixels.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "AContourRelaxation.h"
+#include "FeatureType.h"
+#include "GrayvalueFeature.h"
+#include "ColorFeature.h"
+#include "CompactnessFeature.h"
+#include "DepthFeature.h"
+
+#include <opencv2/opencv.hpp>
+#include <boost/shared_ptr.hpp>
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+
+
+/**
+ * @class StaticFeatureSet
+ * @brief Feature set for AContourRelaxation::relaxLabels with the enabled features fixed at compile time.
+ *
+ * The features are stored by value and called without going through the IFeature interface, so the
+ * compiler can inline the costs of all enabled features into the relaxation. The checks for disabled
+ * features are constant and compiled away.
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+class StaticFeatureSet
+{
+    public:
+
+        GrayvalueFeature<TLabelImage> grayvalueFeature; ///< The grayvalue feature object, used if TGrayvalue is true.
+        ColorFeature<TLabelImage> colorFeature; ///< The color feature object, used if TColor is true.
+        DepthFeature<TLabelImage> depthFeature; ///< The depth feature object, used if TDepth is true.
+        CompactnessFeature<TLabelImage> compactnessFeature; ///< The compactness feature object, used if TCompactness is true.
+
+        void initializeStatistics(cv::Mat const& labelImage);
+
+        double calculateCost(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& pretendLabel,
+            std::vector<TLabelImage> const& neighbourLabels) const;
+
+        void updateStatistics(cv::Point2i const& curPixelCoords, TLabelImage const& oldLabel, TLabelImage const& newLabel);
+};
+
+
+/**
+ * @brief Compute the internal label statistics of all enabled features for all labels in the given label image.
+ * @param labelImage the current label image, contains one label identifier per pixel
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+void StaticFeatureSet<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::initializeStatistics(cv::Mat const& labelImage)
+{
+    if (TGrayvalue)
+    {
+        grayvalueFeature.GrayvalueFeature<TLabelImage>::initializeStatistics(labelImage);
+    }
+
+    if (TColor)
+    {
+        colorFeature.ColorFeature<TLabelImage>::initializeStatistics(labelImage);
+    }
+
+    if (TDepth)
+    {
+        depthFeature.DepthFeature<TLabelImage>::initializeStatistics(labelImage);
+    }
+
+    if (TCompactness)
+    {
+        compactnessFeature.CompactnessFeature<TLabelImage>::initializeStatistics(labelImage);
+    }
+}
+
+
+/**
+ * @brief Calculate the cost of all enabled features for all labels in the 8-neighbourhood of a pixel, assuming the pixel would change its label.
+ * @param curPixelCoords coordinates of the regarded pixel
+ * @param oldLabel old label of the regarded pixel
+ * @param pretendLabel assumed new label of the regarded pixel
+ * @param neighbourLabels all labels found in the 8-neighbourhood of the regarded pixel, including the old label of the pixel itself
+ * @return the cost summed over all enabled features
+ *
+ * The features are added up in the order of FeatureType. ContourRelaxation adds them up in the order of its features vector,
+ * so both give the same costs only if that vector lists the features in the order of FeatureType.
+ * The qualified calls bypass the virtual function table.
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+double StaticFeatureSet<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::calculateCost(cv::Point2i const& curPixelCoords,
+    TLabelImage const& oldLabel, TLabelImage const& pretendLabel, std::vector<TLabelImage> const& neighbourLabels) const
+{
+    double cost = 0;
+
+    if (TGrayvalue)
+    {
+        cost += grayvalueFeature.GrayvalueFeature<TLabelImage>::calculateCost(curPixelCoords, oldLabel, pretendLabel, neighbourLabels);
+    }
+
+    if (TColor)
+    {
+        cost += colorFeature.ColorFeature<TLabelImage>::calculateCost(curPixelCoords, oldLabel, pretendLabel, neighbourLabels);
+    }
+
+    if (TCompactness)
+    {
+        cost += compactnessFeature.CompactnessFeature<TLabelImage>::calculateCost(curPixelCoords, oldLabel, pretendLabel, neighbourLabels);
+    }
+
+    if (TDepth)
+    {
+        cost += depthFeature.DepthFeature<TLabelImage>::calculateCost(curPixelCoords, oldLabel, pretendLabel, neighbourLabels);
+    }
+
+    return cost;
+}
+
+
+/**
+ * @brief Update the label statistics of all enabled features to reflect a label change of the given pixel.
+ * @param curPixelCoords coordinates of the pixel whose label changes
+ * @param oldLabel old label of the changing pixel
+ * @param newLabel new label of the changing pixel
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+void StaticFeatureSet<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::updateStatistics(cv::Point2i const& curPixelCoords,
+    TLabelImage const& oldLabel, TLabelImage const& newLabel)
+{
+    if (TGrayvalue)
+    {
+        grayvalueFeature.GrayvalueFeature<TLabelImage>::updateStatistics(curPixelCoords, oldLabel, newLabel);
+    }
+
+    if (TColor)
+    {
+        colorFeature.ColorFeature<TLabelImage>::updateStatistics(curPixelCoords, oldLabel, newLabel);
+    }
+
+    if (TDepth)
+    {
+        depthFeature.DepthFeature<TLabelImage>::updateStatistics(curPixelCoords, oldLabel, newLabel);
+    }
+
+    if (TCompactness)
+    {
+        compactnessFeature.CompactnessFeature<TLabelImage>::updateStatistics(curPixelCoords, oldLabel, newLabel);
+    }
+}
+
+
+/**
+ * @class StaticContourRelaxation
+ * @brief Class for applying Contour Relaxation to a label image, with the enabled features fixed at compile time.
+ *
+ * Gives the same results as ContourRelaxation with the same features enabled, if ContourRelaxation gets them in the
+ * order of FeatureType (floating point sums depend on the order). Use createContourRelaxation
+ * to get the instantiation for a set of features chosen at runtime.
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+class StaticContourRelaxation : public AContourRelaxation<TLabelImage>
+{
+    private:
+
+        /// The enabled features. Mutable since relax() is const but needs to update the label statistics.
+        mutable StaticFeatureSet<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness> featureSet;
+
+
+    public:
+
+        void relax(cv::Mat const& labelImage, double const& directCliqueCost, double const& diagonalCliqueCost,
+            unsigned int const& numIterations, cv::Mat& out_labelImage, cv::Mat& out_regionMeanImage) const;
+
+        void setGrayvalueData(cv::Mat const& grayvalueImage);
+
+        void setColorData(cv::Mat const& channel1, cv::Mat const& channel2, cv::Mat const& channel3);
+
+        void setDepthData(cv::Mat const& depth);
+
+        void setCompactnessData(double const& compactnessWeight);
+};
+
+
+/**
+ * @brief Apply Contour Relaxation to the given label image, with the features enabled in this StaticContourRelaxation type.
+ * @param labelImage the input label image, containing one label identifier per pixel
+ * @param directCliqueCost Markov clique cost for one clique in horizontal or vertical direction
+ * @param diagonalCliqueCost Markov clique cost for one clique in diagonal direction
+ * @param numIterations number of iterations of Contour Relaxation to be performed (one iteration can include multiple passes)
+ * @param out_labelImage the resulting label image after Contour Relaxation, will be (re)allocated if necessary
+ * @param out_regionMeanImage the region mean image of the resulting label image (if grayvalue or color feature enabled, else an empty matrix header)
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+void StaticContourRelaxation<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::relax(cv::Mat const& labelImage,
+    double const& directCliqueCost, double const& diagonalCliqueCost, unsigned int const& numIterations,
+    cv::Mat& out_labelImage, cv::Mat& out_regionMeanImage) const
+{
+    assert(labelImage.type() == cv::DataType<TLabelImage>::type);
+    assert(directCliqueCost >= 0);
+    assert(diagonalCliqueCost >= 0);
+
+    this->relaxLabels(featureSet, labelImage, directCliqueCost, diagonalCliqueCost, numIterations, out_labelImage);
+
+    // Generate an image which represents all pixels by the mean grayvalue of their label.
+    if (TColor)
+    {
+        featureSet.colorFeature.generateRegionMeanImage(out_labelImage, out_regionMeanImage);
+    }
+    else if (TGrayvalue)
+    {
+        featureSet.grayvalueFeature.generateRegionMeanImage(out_labelImage, out_regionMeanImage);
+    }
+    else
+    {
+        out_regionMeanImage = cv::Mat();
+    }
+}
+
+
+/**
+ * @brief Set the observed data for the grayvalue feature.
+ * @param grayvalueImage the observed grayvalue image
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+void StaticContourRelaxation<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::setGrayvalueData(cv::Mat const& grayvalueImage)
+{
+    assert(TGrayvalue == true);
+
+    featureSet.grayvalueFeature.setData(grayvalueImage);
+}
+
+
+/**
+ * @brief Set the observed data for the color feature.
+ * @param channel1 the observed first image channel
+ * @param channel2 the observed second image channel
+ * @param channel3 the observed third image channel
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+void StaticContourRelaxation<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::setColorData(cv::Mat const& channel1,
+    cv::Mat const& channel2, cv::Mat const& channel3)
+{
+    assert(TColor == true);
+
+    featureSet.colorFeature.setData(channel1, channel2, channel3);
+}
+
+
+/**
+ * @brief Set the observed data for the depth feature.
+ * @param depth the observed depth image
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+void StaticContourRelaxation<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::setDepthData(cv::Mat const& depth)
+{
+    assert(TDepth == true);
+
+    featureSet.depthFeature.setData(depth);
+}
+
+
+/**
+ * @brief Set the compactness weight for the compactness feature.
+ * @param compactnessWeight the compactness weight to be multiplied with the compactness cost before returning that
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth, bool TCompactness>
+void StaticContourRelaxation<TLabelImage, TGrayvalue, TColor, TDepth, TCompactness>::setCompactnessData(double const& compactnessWeight)
+{
+    assert(TCompactness == true);
+
+    featureSet.compactnessFeature.setData(compactnessWeight);
+}
+
+
+/**
+ * @brief Create the StaticContourRelaxation for the given grayvalue, color and depth features, deciding on the compactness feature.
+ * @param compactness true if the compactness feature is enabled
+ * @return the new StaticContourRelaxation object
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor, bool TDepth>
+boost::shared_ptr< AContourRelaxation<TLabelImage> > createStaticContourRelaxation(bool compactness)
+{
+    if (compactness)
+    {
+        return boost::shared_ptr< AContourRelaxation<TLabelImage> >
+            (new StaticContourRelaxation<TLabelImage, TGrayvalue, TColor, TDepth, true>());
+    }
+
+    return boost::shared_ptr< AContourRelaxation<TLabelImage> >
+        (new StaticContourRelaxation<TLabelImage, TGrayvalue, TColor, TDepth, false>());
+}
+
+
+/**
+ * @brief Create the StaticContourRelaxation for the given grayvalue and color features, deciding on the remaining features.
+ * @param depth true if the depth feature is enabled
+ * @param compactness true if the compactness feature is enabled
+ * @return the new StaticContourRelaxation object
+ */
+template <typename TLabelImage, bool TGrayvalue, bool TColor>
+boost::shared_ptr< AContourRelaxation<TLabelImage> > createStaticContourRelaxation(bool depth, bool compactness)
+{
+    if (depth)
+    {
+        return createStaticContourRelaxation<TLabelImage, TGrayvalue, TColor, true>(compactness);
+    }
+
+    return createStaticContourRelaxation<TLabelImage, TGrayvalue, TColor, false>(compactness);
+}
+
+
+/**
+ * @brief Create the StaticContourRelaxation for the given grayvalue feature, deciding on the remaining features.
+ * @param color true if the color feature is enabled
+ * @param depth true if the depth feature is enabled
+ * @param compactness true if the compactness feature is enabled
+ * @return the new StaticContourRelaxation object
+ */
+template <typename TLabelImage, bool TGrayvalue>
+boost::shared_ptr< AContourRelaxation<TLabelImage> > createStaticContourRelaxation(bool color, bool depth, bool compactness)
+{
+    if (color)
+    {
+        return createStaticContourRelaxation<TLabelImage, TGrayvalue, true>(depth, compactness);
+    }
+
+    return createStaticContourRelaxation<TLabelImage, TGrayvalue, false>(depth, compactness);
+}
+
+
+/**
+ * @brief Create a Contour Relaxation object with the specified features enabled, choosing the matching StaticContourRelaxation.
+ * @param features contains the features to be enabled, duplicates are ignored
+ * @return the new Contour Relaxation object, which gives the same results as ContourRelaxation with the same features
+ *         listed in the order of FeatureType
+ */
+template <typename TLabelImage>
+boost::shared_ptr< AContourRelaxation<TLabelImage> > createContourRelaxation(std::vector<FeatureType> const& features)
+{
+    bool const grayvalue = std::find(features.begin(), features.end(), Grayvalue) != features.end();
+    bool const color = std::find(features.begin(), features.end(), Color) != features.end();
+    bool const depth = std::find(features.begin(), features.end(), Depth) != features.end();
+    bool const compactness = std::find(features.begin(), features.end(), Compactness) != features.end();
+
+    if (grayvalue)
+    {
+        return createStaticContourRelaxation<TLabelImage, true>(color, depth, compactness);
+    }
+
+    return createStaticContourRelaxation<TLabelImage, false>(color, depth, compactness);
+}
@@ -31,7 +31,7 @@
 #include "SeedsRevised.h"
 
 #include "contourRelaxation/FeatureType.h"
-#include "contourRelaxation/ContourRelaxation.h"
+#include "contourRelaxation/StaticContourRelaxation.h"
 #include "contourRelaxation/InitializationFunctions.h"
 #include "VisualizationHelper.h"
 
@@ -147,7 +147,8 @@ int main(int argc, char* argv[])
     typedef boost::uint16_t TLabelImage;
 
     // Create an instance of the Contour Relaxation class with the selected features.
-    ContourRelaxation<TLabelImage> contourRelaxationInst(enabledFeatures);
+    // The features are fixed at compile time in the returned object, which makes it faster than ContourRelaxation.
+    boost::shared_ptr< AContourRelaxation<TLabelImage> > contourRelaxationInst = createContourRelaxation<TLabelImage>(enabledFeatures);
 
     // Initialize the label image with a "blind segmentation" of rectangular blocks.
     // You can also use createDiamondInitialization from contourRelaxation/InitializationFunctions.h
@@ -156,7 +157,7 @@ int main(int argc, char* argv[])
     cv::Mat labelImage = createBlockInitialization<TLabelImage>(image.size(), blockWidth, blockHeight);
 
     // Set data for all features.
-    contourRelaxationInst.setCompactnessData(compactnessWeight);
+    contourRelaxationInst->setCompactnessData(compactnessWeight);
 
     if (isColorImage)
     {
@@ -166,7 +167,7 @@ int main(int argc, char* argv[])
         std::vector<cv::Mat> imageYCrCbChannels;
         cv::split(imageYCrCb, imageYCrCbChannels);
 
-        contourRelaxationInst.setColorData(imageYCrCbChannels[0], imageYCrCbChannels[1], imageYCrCbChannels[2]);
+        contourRelaxationInst->setColorData(imageYCrCbChannels[0], imageYCrCbChannels[1], imageYCrCbChannels[2]);
     }
     else
     {
@@ -176,14 +177,14 @@ int main(int argc, char* argv[])
         cv::Mat imageGray = image.clone();
         cv::cvtColor(imageGray, image, CV_GRAY2BGR);
 
-        contourRelaxationInst.setGrayvalueData(imageGray);
+        contourRelaxationInst->setGrayvalueData(imageGray);
     }
 
     // Perform contour relaxation.
     cv::Mat relaxedLabelImage;
     cv::Mat regionMeanImage;
-    contourRelaxationInst.relax(labelImage, directCliqueCost, diagonalCliqueCost,
-                                numIterations, relaxedLabelImage, regionMeanImage);
+    contourRelaxationInst->relax(labelImage, directCliqueCost, diagonalCliqueCost,
+                                 numIterations, relaxedLabelImage, regionMeanImage);
 
     if (isColorImage)
     {
@@ -29,7 +29,6 @@ public:
 	int a_;
 	int b_;
 	double w_;
-	double gain_;
 	inline Edge &operator=(const Edge &rhs);
 	inline bool operator==(const Edge &other) const;
 	inline bool operator!=(const Edge &other) const;
@@ -45,7 +44,6 @@ Edge &Edge::operator=(const Edge &rhs)
 	a_ = rhs.a_;
 	b_ = rhs.b_;
 	w_ = rhs.w_;
-	gain_ = rhs.gain_;
 	return *this;
 }
 
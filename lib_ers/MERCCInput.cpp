@@ -21,11 +21,57 @@ AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING
 OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. 
 */
 #include "MERCInput.h"
+#include "MERCGraph.h"
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define GRAPH_MAGIC "ERSG"
+#define GRAPH_VERSION 1
+
+// magic and five integers, so the edges are aligned to their doubles
+#define GRAPH_HEADER_SIZE 24
+
+// write the edges given by G, see MERCGraph.h, as binary records
+template <class G>
+static void WriteEdges(std::ofstream &file,G &edges,int weightType)
+{
+	int a,b;
+	for(int i=0;i<edges.rNumEdges();i++)
+	{
+		edges.Ends(i,a,b);
+		file.write((const char*) &a, sizeof(int));
+		file.write((const char*) &b, sizeof(int));
+		if(weightType == MERCInput::FLOAT_WEIGHTS)
+		{
+			float w = (float) edges.W(i);
+			file.write((const char*) &w, sizeof(float));
+		}
+		else
+		{
+			double w = edges.W(i);
+			file.write((const char*) &w, sizeof(double));
+		}
+	}
+}
 
 MERCInput::MERCInput()
 {
 	edges_ = NULL;
+	loop_ = NULL;
+	size_ = NULL;
+	weights_ = NULL;
+	width_ = 0;
+	height_ = 0;
+	conn8_ = 0;
+	map_ = NULL;
+	mapSize_ = 0;
 }
 
 MERCInput::~MERCInput()
@@ -35,9 +81,24 @@ MERCInput::~MERCInput()
 
 void MERCInput::Release()
 {
-	if(edges_)
+	if(edges_ && !map_)
 		delete [] edges_;
 	edges_ = NULL;
+#ifndef _WIN32
+	if(map_)
+		munmap(map_, mapSize_);
+#endif
+	map_ = NULL;
+	mapSize_ = 0;
+	if(loop_)
+		delete [] loop_;
+	loop_ = NULL;
+	if(size_)
+		delete [] size_;
+	size_ = NULL;
+	if(weights_)
+		delete [] weights_;
+	weights_ = NULL;
 }
 
 void MERCInput::ReadFromMatlab(double *pI,double *pJ,double *pW,int nEdges,int nNodes)
@@ -78,7 +139,146 @@ void MERCInput::Write(const char* filename)
 	file.open(filename);
 	file.precision(6);
 	file<<nNodes_<<endl<<nEdges_<<endl;
-	for(int i=0;i<nEdges_;i++)
-		file<<edges_[i].a_<<" "<<edges_[i].b_<<" "<<std::fixed<<edges_[i].w_<<std::endl;
+	if(edges_)
+	{
+		for(int i=0;i<nEdges_;i++)
+			file<<edges_[i].a_<<" "<<edges_[i].b_<<" "<<std::fixed<<edges_[i].w_<<std::endl;
+	}
+	else
+	{
+		MERCGridEdges grid(*this);
+		int a,b;
+		for(int i=0;i<nEdges_;i++)
+		{
+			grid.Ends(i,a,b);
+			file<<a<<" "<<b<<" "<<std::fixed<<grid.W(i)<<std::endl;
+		}
+	}
+	file.close();
+}
+
+bool MERCInput::WriteBinary(const char* filename,int weightType)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if(!file.is_open())
+	{
+		cerr<<"Cannot open file "<<filename<<endl;
+		return false;
+	}
+
+	int header[5] = {GRAPH_VERSION, nNodes_, nEdges_, weightType, 0};
+	file.write(GRAPH_MAGIC, 4);
+	file.write((const char*) header, sizeof(header));
+	if(edges_ && weightType == DOUBLE_WEIGHTS && sizeof(Edge) == 2*sizeof(int)+sizeof(double))
+		file.write((const char*) edges_, (size_t) nEdges_*sizeof(Edge));
+	else if(edges_)
+	{
+		MERCEdgeList list(*this);
+		WriteEdges(file,list,weightType);
+	}
+	else
+	{
+		MERCGridEdges grid(*this);
+		WriteEdges(file,grid,weightType);
+	}
 	file.close();
-}
\ No newline at end of file
+	return true;
+}
+
+bool MERCInput::ReadBinary(const char* filename)
+{
+	Release();
+	std::ifstream file(filename, std::ios::binary);
+	if(!file.is_open())
+	{
+		cerr<<"Cannot open file "<<filename<<endl;
+		return false;
+	}
+
+	char magic[4];
+	int header[5] = {0};
+	file.read(magic, 4);
+	file.read((char*) header, sizeof(header));
+	file.seekg(0, std::ios::end);
+	size_t fileSize = (size_t) file.tellg();
+	size_t recordSize = 2*sizeof(int) + (header[3] == FLOAT_WEIGHTS ? sizeof(float) : sizeof(double));
+	if(!file || memcmp(magic, GRAPH_MAGIC, 4) != 0 || header[0] != GRAPH_VERSION || header[1] < 0 || header[2] < 0
+		|| (header[3] != DOUBLE_WEIGHTS && header[3] != FLOAT_WEIGHTS) || fileSize != GRAPH_HEADER_SIZE + (size_t) header[2]*recordSize)
+	{
+		cerr<<"Invalid graph "<<filename<<endl;
+		return false;
+	}
+	nNodes_ = header[1];
+	nEdges_ = header[2];
+
+#ifndef _WIN32
+	// the edges are used where they are in the file, private so that the
+	// changes of the weights stay in memory
+	if(header[3] == DOUBLE_WEIGHTS && sizeof(Edge) == recordSize)
+	{
+		int fd = open(filename, O_RDONLY);
+		void *map = fd < 0 ? MAP_FAILED : mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if(fd >= 0)
+			close(fd);
+		if(map != MAP_FAILED)
+		{
+			map_ = map;
+			mapSize_ = fileSize;
+			edges_ = (Edge*) ((char*) map + GRAPH_HEADER_SIZE);
+		}
+	}
+#endif
+
+	// otherwise the records are read and converted in blocks
+	if(!map_)
+	{
+		edges_ = new Edge [nEdges_];
+		file.clear();
+		file.seekg(GRAPH_HEADER_SIZE);
+		vector<char> block(4096*recordSize);
+		for(int i=0;i<nEdges_;i+=4096)
+		{
+			int n = min(4096, nEdges_-i);
+			file.read(&block[0], n*recordSize);
+			for(int k=0;k<n;k++)
+			{
+				const char *record = &block[k*recordSize];
+				memcpy(&edges_[i+k].a_, record, sizeof(int));
+				memcpy(&edges_[i+k].b_, record + sizeof(int), sizeof(int));
+				if(header[3] == FLOAT_WEIGHTS)
+				{
+					float w;
+					memcpy(&w, record + 2*sizeof(int), sizeof(float));
+					edges_[i+k].w_ = w;
+				}
+				else
+					memcpy(&edges_[i+k].w_, record + 2*sizeof(int), sizeof(double));
+			}
+		}
+		if(!file)
+		{
+			cerr<<"Invalid graph "<<filename<<endl;
+			Release();
+			return false;
+		}
+	}
+
+	// the end points index the disjoint set
+	for(int i=0;i<nEdges_;i++)
+	{
+		if(edges_[i].a_ < 0 || edges_[i].a_ >= nNodes_ || edges_[i].b_ < 0 || edges_[i].b_ >= nNodes_)
+		{
+			cerr<<"Invalid graph "<<filename<<endl;
+			Release();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MERCInput::ConvertToBinary(const char* textFile,const char* binaryFile,int weightType)
+{
+	MERCInput input;
+	input.Read(textFile);
+	return input.WriteBinary(binaryFile,weightType);
+}
@@ -23,22 +23,20 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "MERCDisjointSet.h"
 
 
-MERCDisjointSet::MERCDisjointSet(int nElements) 
+MERCDisjointSet::MERCDisjointSet(int nElements,const int *sizes) 
 {	
 	nElements_ = nElements;
 	nVertices_ = nElements_;
 	p_ = new int [nElements_];
 	size_ = new int [nElements_];
-	lists_ = new MList<int> [nElements_];
 
-
-	int reservedSize = (int)std::sqrt( 1.0*nElements );
 	// Initialization with the cluster size and id
+	totalSize_ = 0;
 	for (int i = 0; i < nElements; i++) 
 	{
 		p_[i] = i;
-		size_[i] = 1;
-		lists_[i].PushBack(i);
+		size_[i] = sizes ? sizes[i] : 1;
+		totalSize_ += size_[i];
 	}
 }
   
@@ -51,10 +49,8 @@ void MERCDisjointSet::Release()
 {
 	delete [] p_;
 	delete [] size_;
-	delete [] lists_;
 	p_ = NULL;
 	size_ = NULL;
-	lists_ = NULL;
 
 }
 
@@ -65,8 +61,19 @@ void MERCDisjointSet::Set(int x,int l)
 
 int MERCDisjointSet::Find(int x) 
 {
-	// return the cluster ID
-	return p_[x];
+	// walk up to the root, which is the cluster ID
+	int root = x;
+	while( p_[root] != root )
+		root = p_[root];
+
+	// let every vertex on the path point to the root directly
+	while( p_[x] != root )
+	{
+		int next = p_[x];
+		p_[x] = root;
+		x = next;
+	}
+	return root;
 }
 
 int MERCDisjointSet::Join(int x, int y) 
@@ -94,11 +101,12 @@ int MERCDisjointSet::Join(int x, int y)
 	size_[newID] = aSize+bSize;
 	size_[delID] = 0;
 
-	MListNode<int> *iter;
-	for(iter=lists_[delID].first_;iter!=NULL;iter=iter->next_)
-		p_[iter->data_] = newID;
-	lists_[newID].Append(lists_[delID]);
+	// only the root of the smaller cluster is relinked, its members are
+	// updated lazily by Find
+	p_[delID] = newID;
 
+	// the tiles of MERCLazyGreedy join their clusters in parallel
+	#pragma omp atomic
 	nElements_--;
 	return newID;
 }
\ No newline at end of file
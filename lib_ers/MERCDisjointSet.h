@@ -27,23 +27,24 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <vector>
 #include <cmath>
 #include <stack>
-#include "MList.h"
 
 
 class MERCDisjointSet
 {
 public:
-	MERCDisjointSet(int nElements);
+	// each vertex is a cluster of its own with the given size, one by default
+	MERCDisjointSet(int nElements,const int *sizes=NULL);
 	~MERCDisjointSet();
 	virtual void Release();
 
 	// set the pixel x with label l
 	virtual void Set(int x,int l);
 
-	// find the cluster ID for a given vertex
+	// find the cluster ID for a given vertex, compressing the path to the root
 	virtual int Find(int x);
 
-	// joint the cluster contains vertex y and the cluster contains vertex x
+	// joint the cluster contains vertex y and the cluster contains vertex x,
+	// the larger cluster becomes the root (union by size)
 	virtual int Join(int x,int y);
 
 	// return the cluster size containing the vertex x
@@ -55,13 +56,17 @@ public:
 	// return the total number of vertices in the set
 	int rNumVertices() const {return nVertices_;};
 
+	// return the sum of the sizes of all vertices
+	int rTotalSize() const {return totalSize_;};
+
 private:
 
+	// parent of each vertex, roots point to themselves
 	int *p_;
 	int *size_;
-	MList<int> *lists_;
 	int nElements_;
 	int nVertices_;
+	int totalSize_;
 };
 
 
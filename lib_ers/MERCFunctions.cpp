@@ -45,11 +45,13 @@ void MERCFunctions::NormalizeEdgeWeight(MERCInput &edges,double *loop,double wT)
 {
 	int nEdges = edges.nEdges_;
 	int nVertices = edges.nNodes_;
+	#pragma omp parallel for
 	for(int i=0;i<nEdges;i++)
 	{
 		edges.edges_[i].w_ /= wT;
 	}
 
+	#pragma omp parallel for
 	for(int i=0;i<nVertices;i++)
 	{
 		loop[i] /= wT;
@@ -0,0 +1,97 @@
+#ifndef _m_erc_gains_h_
+#define _m_erc_gains_h_
+
+#include "MERCDisjointSet.h"
+#include <vector>
+#include <cmath>
+
+using namespace std;
+
+// The gains of MERCFunctions::ComputeERGain and ComputeBGain with their x*log(x)
+// terms cached: the term of the loop weight of each vertex, which only changes
+// when an edge at the vertex is added, and the term of each cluster size. A
+// term is only taken from the cache if its argument is the same double as in
+// ComputeERGain and ComputeBGain, so the gains are the same bit for bit.
+class MERCGains
+{
+public:
+
+	// the loop weights are normalized and owned by the caller
+	MERCGains(MERCDisjointSet *u,double *loop);
+
+	// gain in the entropy rate of adding an edge of weight w between ea and eb
+	inline double ERGain(double w,int ea,int eb) const;
+
+	// gain in the balancing term of joining the clusters with roots a and b
+	inline double BGain(int a,int b) const;
+
+	// remove the weight w of an added edge from the loops at ea and eb
+	inline void AddEdge(double w,int ea,int eb);
+
+private:
+
+	MERCDisjointSet *u_;
+	double *loop_;
+	int totalSize_;
+
+	// loop_[v]*log(loop_[v])
+	vector<double> loopTerm_;
+
+	// S*log(S) with S = s*1.0/totalSize_ for each size s
+	vector<double> sizeTerm_;
+
+	static double XLogX(double x) {return x*log(x);};
+};
+
+inline MERCGains::MERCGains(MERCDisjointSet *u,double *loop)
+{
+	u_ = u;
+	loop_ = loop;
+	totalSize_ = u->rTotalSize();
+
+	int nVertices = u->rNumVertices();
+	loopTerm_.resize(nVertices);
+	#pragma omp parallel for
+	for(int v=0;v<nVertices;v++)
+		loopTerm_[v] = XLogX(loop_[v]);
+
+	sizeTerm_.resize(totalSize_+1);
+	#pragma omp parallel for
+	for(int s=1;s<=totalSize_;s++)
+		sizeTerm_[s] = XLogX(s*1.0/totalSize_);
+}
+
+inline double MERCGains::ERGain(double w,int ea,int eb) const
+{
+	// ci+w is the loop weight of ea unless ci was rounded
+	double ci = loop_[ea]-w;
+	double cj = loop_[eb]-w;
+	double ti = (w+ci == loop_[ea]) ? loopTerm_[ea] : XLogX(w+ci);
+	double tj = (w+cj == loop_[eb]) ? loopTerm_[eb] : XLogX(w+cj);
+	double er = (ti + tj - XLogX(ci) - XLogX(cj) - 2*w*log(w))/log(2.0);
+	if( er!=er )
+		return 0;
+	else
+		return er;
+}
+
+inline double MERCGains::BGain(int a,int b) const
+{
+	int si = u_->rSize(a);
+	int sj = u_->rSize(b);
+
+	// Si+Sj is the fraction of si+sj unless the sum was rounded
+	double S = si*1.0/totalSize_ + sj*1.0/totalSize_;
+	double t = (S == (si+sj)*1.0/totalSize_) ? sizeTerm_[si+sj] : XLogX(S);
+	return (-t + sizeTerm_[si] + sizeTerm_[sj])/log(2.0) + 1.0;
+}
+
+inline void MERCGains::AddEdge(double w,int ea,int eb)
+{
+	loop_[ea] -= w;
+	loop_[eb] -= w;
+	loopTerm_[ea] = XLogX(loop_[ea]);
+	loopTerm_[eb] = XLogX(loop_[eb]);
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef _m_erc_graph_h_
+#define _m_erc_graph_h_
+
+#include "MERCInput.h"
+
+// Access to the edges of a MERCInput for the clustering and the heap, which
+// are compiled once for each way of storing the edges. Ends returns the end
+// points of edge i and W its weight. Weight is also the type of the gains in
+// the heap, so a compact graph has a compact heap.
+
+// edges stored in edges_
+class MERCEdgeList
+{
+public:
+	typedef double Weight;
+
+	MERCEdgeList(MERCInput &input) : edges_(input.edges_), nEdges_(input.nEdges_) {};
+
+	int rNumEdges() const {return nEdges_;};
+
+	void Ends(int i,int &a,int &b) const {a = edges_[i].a_; b = edges_[i].b_;};
+
+	Weight &W(int i) {return edges_[i].w_;};
+
+private:
+	Edge *edges_;
+	int nEdges_;
+};
+
+// the edges of G with the given indices
+template <class G>
+class MERCEdgeSubset
+{
+public:
+	typedef typename G::Weight Weight;
+
+	MERCEdgeSubset(G &edges,const int *index,int nEdges) : edges_(edges), index_(index), nEdges_(nEdges) {};
+
+	int rNumEdges() const {return nEdges_;};
+
+	void Ends(int i,int &a,int &b) const {edges_.Ends(index_[i],a,b);};
+
+	Weight &W(int i) {return edges_.W(index_[i]);};
+
+private:
+	G edges_;
+	const int *index_;
+	int nEdges_;
+};
+
+// edges of a grid stored as weights_ in the order of MERCInputImage::ReadImage:
+// row by row, and in a row the edges to the right, down, down right and up
+// right of each pixel. All rows but the first and the last one have the same
+// number of edges, so the end points follow from the index with two divisions.
+class MERCGridEdges
+{
+public:
+	typedef float Weight;
+
+	MERCGridEdges(MERCInput &input);
+
+	int rNumEdges() const {return nEdges_;};
+
+	inline void Ends(int i,int &a,int &b) const;
+
+	Weight &W(int i) {return weights_[i];};
+
+private:
+	enum { FIRST = 0, INNER = 1, LAST = 2 };
+
+	float *weights_;
+	int nEdges_;
+	int width_;
+	int height_;
+
+	// number of edges starting at the pixels of a row but the last one, which
+	// only has the edge down, and the offsets from a_ to b_ of these edges
+	int perPixel_[3];
+	int offset_[3][4];
+
+	// number of edges in the first row and in each inner row, and index of
+	// the first edge of the last row
+	int firstRow_;
+	int innerRow_;
+	int lastRowStart_;
+};
+
+inline MERCGridEdges::MERCGridEdges(MERCInput &input)
+{
+	weights_ = input.weights_;
+	nEdges_ = input.nEdges_;
+	width_ = input.width_;
+	height_ = input.height_;
+
+	int right = 1;
+	int down = width_;
+	int diagonal = width_ + 1;
+	int up = 1 - width_;
+
+	// a single row only has edges to the right
+	int k = 0;
+	offset_[FIRST][k++] = right;
+	if(height_ > 1)
+	{
+		offset_[FIRST][k++] = down;
+		if(input.conn8_==1)
+			offset_[FIRST][k++] = diagonal;
+	}
+	perPixel_[FIRST] = k;
+
+	k = 0;
+	offset_[INNER][k++] = right;
+	offset_[INNER][k++] = down;
+	if(input.conn8_==1)
+	{
+		offset_[INNER][k++] = diagonal;
+		offset_[INNER][k++] = up;
+	}
+	perPixel_[INNER] = k;
+
+	k = 0;
+	offset_[LAST][k++] = right;
+	if(input.conn8_==1)
+		offset_[LAST][k++] = up;
+	perPixel_[LAST] = k;
+
+	firstRow_ = (width_-1)*perPixel_[FIRST] + (height_ > 1 ? 1 : 0);
+	innerRow_ = (width_-1)*perPixel_[INNER] + 1;
+	lastRowStart_ = firstRow_ + (height_ > 2 ? (height_-2)*innerRow_ : 0);
+}
+
+inline void MERCGridEdges::Ends(int i,int &a,int &b) const
+{
+	int row,y;
+	if(i < firstRow_)
+	{
+		row = FIRST;
+		y = 0;
+	}
+	else if(i < lastRowStart_)
+	{
+		row = INNER;
+		i -= firstRow_;
+		y = i/innerRow_;
+		i -= y*innerRow_;
+		y++;
+	}
+	else
+	{
+		row = LAST;
+		i -= lastRowStart_;
+		y = height_-1;
+	}
+
+	int x = i/perPixel_[row];
+	a = y*width_ + x;
+	if(x == width_-1)
+		b = a + width_;
+	else
+		b = a + offset_[row][ i - x*perPixel_[row] ];
+}
+
+#endif
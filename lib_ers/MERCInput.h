@@ -32,6 +32,9 @@ using namespace std;
 class MERCInput
 {
 public:
+	// type of the weights in the binary format
+	enum { DOUBLE_WEIGHTS = 0, FLOAT_WEIGHTS = 1 };
+
 	MERCInput();
 	~MERCInput();
 	void Release();
@@ -39,11 +42,42 @@ public:
 	void Read(const char* filename);
 	void ReadFromMatlab(double *pI,double *pJ,double *pW,int nEdges,int nNodes);
 
+	// Store the graph in binary form: the magic "ERSG", the version, the number
+	// of nodes and edges, the type of the weights and a zero as 32-bit integers,
+	// then a_, b_ and w_ of each edge. Double weights give the layout of Edge,
+	// so ReadBinary maps the file and uses it as edges_ without copying it.
+	// Float weights take three quarters of the space and are converted.
+	bool WriteBinary(const char* filename,int weightType=DOUBLE_WEIGHTS);
+	bool ReadBinary(const char* filename);
+
+	// convert a graph in the text format of Read to the binary format
+	static bool ConvertToBinary(const char* textFile,const char* binaryFile,int weightType=DOUBLE_WEIGHTS);
+
 public:
 	Edge *edges_;
 	int nEdges_;
 	int nNodes_;
 
+	// loop weights if the edge weights already are similarities, see MERCInputImage
+	double *loop_;
+
+	// number of pixels of each vertex if they are not single pixels, see MERCInputCoarse
+	int *size_;
+
+	// weights of the edges of a width_ x height_ grid if the graph is compact,
+	// edges_ is NULL then and the end points follow from the edge index, see
+	// MERCInputImage::ReadImage and MERCGridEdges. width_ and height_ are also
+	// set for other graphs over the pixels of an image, and zero otherwise.
+	float *weights_;
+	int width_;
+	int height_;
+	int conn8_;
+
+	// file mapped by ReadBinary that edges_ points into. The clustering changes
+	// the weights, which only copies the pages it writes, not the file.
+	void *map_;
+	size_t mapSize_;
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "MERCInputCoarse.h"
+#include "MERCOutput.h"
+#include "MERCGraph.h"
+#include <algorithm>
+#include <stdlib.h>
+
+// edge between two atoms while the edges are aggregated
+struct MERCAtomEdge
+{
+	int a_;
+	int b_;
+	double w_;
+	bool operator<(const MERCAtomEdge &other) const
+	{
+		return a_ < other.a_ || (a_ == other.a_ && b_ < other.b_);
+	}
+};
+
+void MERCInputCoarse::Coarsen(MERCInput &fine,double threshold,int maxSize)
+{
+	if(!fine.loop_)
+	{
+		cerr<<"Coarsen needs the similarities and loop weights of the graph"<<endl;
+		exit(-1);
+	}
+
+	Release();
+	if(fine.edges_)
+	{
+		MERCEdgeList list(fine);
+		Coarsen(list,fine,threshold,maxSize);
+	}
+	else
+	{
+		MERCGridEdges grid(fine);
+		Coarsen(grid,fine,threshold,maxSize);
+	}
+}
+
+template <class G>
+void MERCInputCoarse::Coarsen(G &edges,MERCInput &fine,double threshold,int maxSize)
+{
+	int ea,eb;
+
+	// contract the similar edges in the order of the graph, the size limit
+	// keeps the color of an atom from drifting along smooth gradients
+	MERCDisjointSet u(fine.nNodes_,fine.size_);
+	vector<double> contracted(fine.nNodes_,0.0);
+	for(int i=0;i<fine.nEdges_;i++)
+	{
+		if(edges.W(i) < threshold)
+			continue;
+
+		edges.Ends(i,ea,eb);
+		int a = u.Find( ea );
+		int b = u.Find( eb );
+		if(a!=b && u.rSize(a)+u.rSize(b) <= maxSize)
+		{
+			double w = contracted[a]+contracted[b]+edges.W(i);
+			contracted[ u.Join(a,b) ] = w;
+		}
+	}
+
+	atom_ = MERCOutput::DisjointSetToLabel(&u);
+	nNodes_ = u.rNumSets();
+
+	size_ = new int [nNodes_];
+	loop_ = new double [nNodes_];
+	for(int i=0;i<nNodes_;i++)
+	{
+		size_[i] = 0;
+		loop_[i] = 0;
+	}
+
+	// the contracted edges are added to the graph, so their weights leave the
+	// loops of both ends as in ClusteringTree
+	for(int k=0;k<fine.nNodes_;k++)
+	{
+		size_[ atom_[k] ] += fine.size_ ? fine.size_[k] : 1;
+		loop_[ atom_[k] ] += fine.loop_[k];
+		if(u.Find(k)==k)
+			loop_[ atom_[k] ] -= 2*contracted[k];
+	}
+
+	// once an edge between two atoms is added, the others form cycles, so
+	// only the strongest one is kept
+	vector<MERCAtomEdge> between;
+	for(int i=0;i<fine.nEdges_;i++)
+	{
+		edges.Ends(i,ea,eb);
+		int a = atom_[ ea ];
+		int b = atom_[ eb ];
+		if(a==b)
+			continue;
+
+		MERCAtomEdge edge;
+		edge.a_ = min(a,b);
+		edge.b_ = max(a,b);
+		edge.w_ = edges.W(i);
+		between.push_back(edge);
+	}
+	sort(between.begin(), between.end());
+
+	nEdges_ = 0;
+	for(unsigned int i=0;i<between.size();i++)
+	{
+		if(i==0 || between[i].a_!=between[i-1].a_ || between[i].b_!=between[i-1].b_)
+			nEdges_++;
+	}
+
+	edges_ = new Edge [nEdges_];
+	int num = -1;
+	for(unsigned int i=0;i<between.size();i++)
+	{
+		if(i==0 || between[i].a_!=between[i-1].a_ || between[i].b_!=between[i-1].b_)
+		{
+			num++;
+			edges_[num].a_ = between[i].a_;
+			edges_[num].b_ = between[i].b_;
+			edges_[num].w_ = between[i].w_;
+		}
+		edges_[num].w_ = max(edges_[num].w_, between[i].w_);
+	}
+}
+
+vector<int> MERCInputCoarse::FineLabel(const vector<int> &label)
+{
+	vector<int> fineLabel(atom_.size());
+	for(unsigned int k=0;k<atom_.size();k++)
+		fineLabel[k] = label[ atom_[k] ];
+	return fineLabel;
+}
@@ -0,0 +1,38 @@
+#ifndef _m_erc_input_coarse_h_
+#define _m_erc_input_coarse_h_
+
+#include <vector>
+#include "MERCInput.h"
+#include "MERCDisjointSet.h"
+
+using namespace std;
+
+// A graph over atoms, small groups of neighbouring vertices with similar
+// colors, to run the clustering on far fewer vertices. The atoms are the
+// clusters of the greedy clustering after adding the contracted edges: the
+// size of an atom is its number of pixels, its loop weight is what is left of
+// the loop weights of its pixels, and two atoms are connected by the
+// strongest edge between their pixels.
+class MERCInputCoarse: public MERCInput
+{
+public:
+
+	// Contract the edges of fine with a similarity of at least threshold as
+	// long as the atoms have at most maxSize pixels. fine has to hold the
+	// similarities and loop weights, see MERCInputImage::ReadImage.
+	void Coarsen(MERCInput &fine,double threshold,int maxSize);
+
+	// label array over the vertices of fine from a label array over the atoms
+	vector<int> FineLabel(const vector<int> &label);
+
+	// atom of each vertex of fine
+	vector<int> atom_;
+
+private:
+
+	// Coarsen with the edges of fine given by G, see MERCGraph.h
+	template <class G>
+	void Coarsen(G &edges,MERCInput &fine,double threshold,int maxSize);
+};
+
+#endif
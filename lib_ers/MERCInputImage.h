@@ -26,17 +26,99 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "MERCInput.h"
 #include "Image.h"
 #include <cmath>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
+// An interleaved 8-bit image owned by the caller, such as the data of a
+// cv::Mat, row y starts at data_ + y*step_
+struct MERCByteImage
+{
+	const uchar *data_;
+	int width_;
+	int height_;
+	int step_;
+	int channels_;
+};
+
 template <class T>
 class MERCInputImage: public MERCInput
 {
 public:
 	void ReadImage(Image<T> *inputImage, int conn8=1);	
 
-	int width_;
-	int height_;
+	// Build the graph together with the Gaussian similarities and the loop weights,
+	// processing bands of rows in parallel. The edges are stored in the same order
+	// as by ReadImage above and ClusteringTree uses the similarities and loop
+	// weights instead of computing them, so its sigma and kernel are ignored.
+	// A compact graph only stores the similarities as floats in weights_ and
+	// derives the end points of the edges from their index, see MERCGridEdges,
+	// which takes four instead of sixteen bytes per edge.
+	void ReadImage(Image<T> *inputImage, int conn8, double sigma, bool compact=false);
+
+	// Build the graph as above straight from an interleaved 8-bit image with
+	// the given number of channels whose rows are step bytes apart, e.g. the
+	// data of a cv::Mat, without copying it into an Image. The distance of two
+	// pixels is the sum of the absolute differences of their channels as for
+	// RGBMap.
+	void ReadImage(const uchar *data, int width, int height, int step, int channels, int conn8, double sigma, bool compact=false);
+
+private:
+
+	// directions of the edges starting at a pixel, in the order they are stored
+	enum { RIGHT = 0, DOWN = 1, DIAGONAL = 2, UP = 3 };
+	// number of rows processed by a thread at once
+	enum { BAND_HEIGHT = 64 };
+
+	// index of the first edge starting in each row
+	vector<int> rowOffset_;
+	// similarity of each integer distance for straight and diagonal edges
+	vector<double> straight_;
+	vector<double> diagonal_;
+
+	// build the graph of an image of width_ x height_ pixels whose distances
+	// are sums of at most 255*channels, see RowSimilarity
+	template <class S>
+	void Build(S *inputImage, int channels, int conn8, double sigma, bool compact);
+
+	// similarities of the edges starting in row y, one array per direction
+	void RowSimilarity(Image<T> *inputImage,int y,double twoSigmaSquare,double **similarity);
+	void RowSimilarity(MERCByteImage *inputImage,int y,double twoSigmaSquare,double **similarity);
+
+	// RowSimilarity rounded to the weights of a compact graph, so that the loop
+	// weights are the sums of the stored weights
+	template <class S>
+	void RowWeight(S *inputImage,int y,double twoSigmaSquare,double **similarity);
+
+	// similarities of the edges starting in row of an interleaved 8-bit image,
+	// above and below are the rows next to it or NULL
+	void RowSimilarityBytes(const uchar *above,const uchar *row,const uchar *below,int channels,double **similarity);
+
+	// similarities between n interleaved pixels p and q using the given table,
+	// compiled for one, three and four channels and for any other number as C=0
+	static void PixelSimilarity(const uchar *p,const uchar *q,int n,int channels,const double *table,double *similarity);
+	template <int C>
+	static void PixelSimilarity(const uchar *p,const uchar *q,int n,int channels,const double *table,double *similarity);
+
+	// edges and loop weights of row y from the similarities of rows y-1, y and y+1
+	void RowEdges(int y,double **above,double **similarity,double **below);
+
+	// store edge i, only its weight if the graph is compact
+	void SetEdge(int i,int a,int b,double w)
+	{
+		if (edges_)
+		{
+			edges_[i].a_ = a;
+			edges_[i].b_ = b;
+			edges_[i].w_ = w;
+		}
+		else
+			weights_[i] = (float) w;
+	}
 };
 
 template <class T>
@@ -100,4 +182,288 @@ void MERCInputImage<T>::ReadImage(Image<T> *inputImage, int conn8)
 	nEdges_ = num;
 }
 
-#endif
\ No newline at end of file
+template <class T>
+void MERCInputImage<T>::ReadImage(Image<T> *inputImage, int conn8, double sigma, bool compact)
+{
+	Release();
+	width_ = inputImage->width();
+	height_ = inputImage->height();
+	Build(inputImage, 3, conn8, sigma, compact);
+}
+
+template <class T>
+void MERCInputImage<T>::ReadImage(const uchar *data, int width, int height, int step, int channels, int conn8, double sigma, bool compact)
+{
+	Release();
+	width_ = width;
+	height_ = height;
+	MERCByteImage image = {data, width, height, step, channels};
+	Build(&image, channels, conn8, sigma, compact);
+}
+
+template <class T>
+template <class S>
+void MERCInputImage<T>::Build(S *inputImage, int channels, int conn8, double sigma, bool compact)
+{
+	nNodes_ = width_*height_;
+	conn8_ = conn8;
+
+	// the edges of each row are stored after the edges of the rows above
+	rowOffset_.resize(height_+1);
+	rowOffset_[0] = 0;
+	for (int y = 0; y < height_; y++)
+	{
+		int n = width_-1;
+		if (y < height_-1)
+			n += width_;
+		if (conn8_==1)
+		{
+			if (y < height_-1)
+				n += width_-1;
+			if (y > 0)
+				n += width_-1;
+		}
+		rowOffset_[y+1] = rowOffset_[y] + n;
+	}
+
+	nEdges_ = rowOffset_[height_];
+	if (compact)
+		weights_ = new float [nEdges_];
+	else
+		edges_ = new Edge [nEdges_];
+	loop_ = new double [nNodes_];
+
+	// distances of 8-bit images are integers, see RowSimilarity
+	double twoSigmaSquare = 2*sigma*sigma;
+	straight_.resize(channels*255+1);
+	diagonal_.resize(channels*255+1);
+	for (int d = 0; d <= channels*255; d++)
+	{
+		double w = 1.0*d;
+		straight_[d] = exp( -(w*w)/twoSigmaSquare );
+		w = sqrt(2.0)*d;
+		diagonal_[d] = exp( -(w*w)/twoSigmaSquare );
+	}
+
+	// each band of rows also computes the similarities of the rows next to it,
+	// so that the loop weights are summed without writing to other bands
+	int nBands = (height_ + BAND_HEIGHT - 1)/BAND_HEIGHT;
+	#pragma omp parallel
+	{
+		vector<double> buffer(12*width_);
+		double *rows[3][4];
+		for (int r = 0; r < 3; r++)
+			for (int d = 0; d < 4; d++)
+				rows[r][d] = &buffer[(4*r + d)*width_];
+
+		#pragma omp for schedule(dynamic)
+		for (int band = 0; band < nBands; band++)
+		{
+			int start = band*BAND_HEIGHT;
+			int end = min(start + BAND_HEIGHT, height_);
+
+			double **above = rows[0];
+			double **similarity = rows[1];
+			double **below = rows[2];
+			if (start > 0)
+				RowWeight(inputImage, start-1, twoSigmaSquare, above);
+			RowWeight(inputImage, start, twoSigmaSquare, similarity);
+
+			for (int y = start; y < end; y++)
+			{
+				if (y < height_-1)
+					RowWeight(inputImage, y+1, twoSigmaSquare, below);
+
+				RowEdges(y, above, similarity, below);
+
+				double **tmp = above;
+				above = similarity;
+				similarity = below;
+				below = tmp;
+			}
+		}
+	}
+}
+
+template <class T>
+void MERCInputImage<T>::RowEdges(int y,double **above,double **similarity,double **below)
+{
+	int i = rowOffset_[y];
+	for (int x = 0; x < width_; x++)
+	{
+		int p = y * width_ + x;
+		if (x < width_-1)
+			SetEdge(i++, p, p + 1, similarity[RIGHT][x]);
+
+		if (y < height_-1)
+			SetEdge(i++, p, p + width_, similarity[DOWN][x]);
+
+		if (conn8_==1)
+		{
+			if ((x < width_-1) && (y < height_-1))
+				SetEdge(i++, p, p + width_ + 1, similarity[DIAGONAL][x]);
+
+			if ((x < width_-1) && (y > 0))
+				SetEdge(i++, p, p - width_ + 1, similarity[UP][x]);
+		}
+
+		// ComputeLoopWeight adds the weights in the order of the edges, keep it
+		// so that the loop weights are exactly the same
+		double loop = 0;
+		if (conn8_==1 && x > 0 && y > 0)
+			loop += above[DIAGONAL][x-1];
+		if (y > 0)
+			loop += above[DOWN][x];
+		if (x > 0)
+			loop += similarity[RIGHT][x-1];
+		if (x < width_-1)
+			loop += similarity[RIGHT][x];
+		if (y < height_-1)
+			loop += similarity[DOWN][x];
+		if (conn8_==1)
+		{
+			if (x < width_-1 && y < height_-1)
+				loop += similarity[DIAGONAL][x];
+			if (x < width_-1 && y > 0)
+				loop += similarity[UP][x];
+			if (x > 0 && y < height_-1)
+				loop += below[UP][x-1];
+		}
+		loop_[p] = loop;
+	}
+}
+
+template <class T>
+void MERCInputImage<T>::RowSimilarity(Image<T> *inputImage,int y,double twoSigmaSquare,double **similarity)
+{
+	double w;
+	for (int x = 0; x < width_; x++)
+	{
+		if (x < width_-1)
+		{
+			w = abs(1.0*(inputImage->Access(x,y) - inputImage->Access(x+1,y)));
+			similarity[RIGHT][x] = exp( -(w*w)/twoSigmaSquare );
+		}
+
+		if (y < height_-1)
+		{
+			w = abs(1.0*(inputImage->Access(x,y) - inputImage->Access(x,y+1)));
+			similarity[DOWN][x] = exp( -(w*w)/twoSigmaSquare );
+		}
+
+		if (conn8_==1 && x < width_-1)
+		{
+			if (y < height_-1)
+			{
+				w = sqrt(2.0)*abs(1.0*(inputImage->Access(x,y) - inputImage->Access(x+1,y+1)));
+				similarity[DIAGONAL][x] = exp( -(w*w)/twoSigmaSquare );
+			}
+
+			if (y > 0)
+			{
+				w = sqrt(2.0)*abs(1.0*(inputImage->Access(x,y) - inputImage->Access(x+1,y-1)));
+				similarity[UP][x] = exp( -(w*w)/twoSigmaSquare );
+			}
+		}
+	}
+}
+
+template <class T>
+template <class S>
+void MERCInputImage<T>::RowWeight(S *inputImage,int y,double twoSigmaSquare,double **similarity)
+{
+	RowSimilarity(inputImage, y, twoSigmaSquare, similarity);
+	if (weights_)
+	{
+		for (int d = 0; d < 4; d++)
+			for (int x = 0; x < width_; x++)
+				similarity[d][x] = (float) similarity[d][x];
+	}
+}
+
+// RGBMap distances are sums of absolute byte differences, so the similarities
+// are looked up in the tables computed in Build.
+template <>
+inline void MERCInputImage<RGBMap>::RowSimilarity(Image<RGBMap> *inputImage,int y,double twoSigmaSquare,double **similarity)
+{
+	// RGBMap is three bytes, so the rows are interleaved RGB
+	const uchar *above = y > 0 ? (const uchar*) inputImage->access[y-1] : NULL;
+	const uchar *below = y < height_-1 ? (const uchar*) inputImage->access[y+1] : NULL;
+	RowSimilarityBytes(above, (const uchar*) inputImage->access[y], below, 3, similarity);
+}
+
+template <class T>
+void MERCInputImage<T>::RowSimilarity(MERCByteImage *inputImage,int y,double twoSigmaSquare,double **similarity)
+{
+	const uchar *row = inputImage->data_ + (size_t) y*inputImage->step_;
+	const uchar *above = y > 0 ? row - inputImage->step_ : NULL;
+	const uchar *below = y < height_-1 ? row + inputImage->step_ : NULL;
+	RowSimilarityBytes(above, row, below, inputImage->channels_, similarity);
+}
+
+template <class T>
+void MERCInputImage<T>::RowSimilarityBytes(const uchar *above,const uchar *row,const uchar *below,int channels,double **similarity)
+{
+	PixelSimilarity(row, row + channels, width_-1, channels, &straight_[0], similarity[RIGHT]);
+	if (below)
+	{
+		PixelSimilarity(row, below, width_, channels, &straight_[0], similarity[DOWN]);
+		if (conn8_==1)
+			PixelSimilarity(row, below + channels, width_-1, channels, &diagonal_[0], similarity[DIAGONAL]);
+	}
+
+	if (conn8_==1 && above)
+		PixelSimilarity(row, above + channels, width_-1, channels, &diagonal_[0], similarity[UP]);
+}
+
+template <class T>
+void MERCInputImage<T>::PixelSimilarity(const uchar *p,const uchar *q,int n,int channels,const double *table,double *similarity)
+{
+	switch (channels)
+	{
+	case 1: PixelSimilarity<1>(p, q, n, 1, table, similarity); break;
+	case 3: PixelSimilarity<3>(p, q, n, 3, table, similarity); break;
+	case 4: PixelSimilarity<4>(p, q, n, 4, table, similarity); break;
+	default: PixelSimilarity<0>(p, q, n, channels, table, similarity);
+	}
+}
+
+template <class T>
+template <int C>
+void MERCInputImage<T>::PixelSimilarity(const uchar *p,const uchar *q,int n,int channels,const double *table,double *similarity)
+{
+	if (C)
+		channels = C;
+
+	int i = 0;
+#ifdef __SSE2__
+	// absolute differences of 16 pixels at a time
+	uchar diff[64];
+	for (; channels <= 4 && i + 16 <= n; i += 16)
+	{
+		for (int k = 0; k < channels; k++)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*) (p + channels*i + 16*k));
+			__m128i b = _mm_loadu_si128((const __m128i*) (q + channels*i + 16*k));
+			_mm_storeu_si128((__m128i*) (diff + 16*k), _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a)));
+		}
+
+		for (int k = 0; k < 16; k++)
+		{
+			int d = 0;
+			for (int c = 0; c < channels; c++)
+				d += diff[channels*k + c];
+			similarity[i+k] = table[d];
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		int d = 0;
+		for (int c = 0; c < channels; c++)
+			d += abs(p[channels*i + c] - q[channels*i + c]);
+		similarity[i] = table[d];
+	}
+}
+
+#endif
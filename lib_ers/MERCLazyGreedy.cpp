@@ -22,6 +22,16 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 #include "MERCLazyGreedy.h"
 
+MERCLazyGreedy::MERCLazyGreedy()
+{
+	heapArity_ = 2;
+	tolerance_ = 0;
+	tree_ = NULL;
+	tilesX_ = 1;
+	tilesY_ = 1;
+	tileFactor_ = 3;
+}
+
 MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,int kernel,double sigma,double lambda,int nC)
 {
 	//LARGE_INTEGER t1, t2, f;
@@ -29,37 +39,214 @@ MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,i
 	//QueryPerformanceCounter(&t1);
 
 
-	int nEdges = edges.nEdges_;
-	MERCDisjointSet *u = new MERCDisjointSet(nVertices);
+	MERCDisjointSet *u = new MERCDisjointSet(nVertices,edges.size_);
+	if(tree_)
+		tree_->Reset(nVertices,edges.size_);
 
-	MERCFunctions::ComputeSimilarity(edges,sigma,kernel);
-	double *loop = MERCFunctions::ComputeLoopWeight(nVertices,edges);
+	double *loop;
+	if(edges.loop_)
+	{
+		// the similarities and loop weights were computed with the graph
+		loop = new double [nVertices];
+		for(int i=0;i<nVertices;i++)
+			loop[i] = edges.loop_[i];
+	}
+	else
+	{
+		MERCFunctions::ComputeSimilarity(edges,sigma,kernel);
+		loop = MERCFunctions::ComputeLoopWeight(nVertices,edges);
+	}
 	double wT = MERCFunctions::ComputeTotalWeight(loop,nVertices);
-	MERCFunctions::NormalizeEdgeWeight(edges,loop,wT);
 
-	//
-	// Compute initial gain and decide the weighting on the balancing term
-	//
-	double *erGainArr = new double [nEdges];// gain in entropy rate term
-	double *bGainArr = new double [nEdges];	// gain in balancing term
-	double maxERGain=0,maxBGain=1e-20;
+	int width = 0;
+	if(edges.width_*edges.height_ == nVertices)
+		width = edges.width_;
+
+	// a compact graph only stores the weights of the grid edges
+	if(edges.edges_)
+	{
+		MERCEdgeList list(edges);
+		Cluster(list,u,loop,wT,lambda,width,nVertices,nC);
+	}
+	else
+	{
+		MERCGridEdges grid(edges);
+		Cluster(grid,u,loop,wT,lambda,width,nVertices,nC);
+	}
+
+	delete [] loop;
+	//QueryPerformanceCounter(&t2);
+	//std::cout.precision(6);
+	//std::cout<<std::fixed<<"[TIME] "<<(t2.QuadPart - t1.QuadPart)/(f.QuadPart*1.0)<<" sec."<<std::endl;
+	
+	return u;
+}
+
+template <class G>
+void MERCLazyGreedy::Cluster(G &edges,MERCDisjointSet *u,double *loop,double wT,double lambda,int width,int nVertices,int nC)
+{
+	int nEdges = edges.rNumEdges();
+	#pragma omp parallel for
 	for(int i=0;i<nEdges;i++)
 	{
-		erGainArr[i] = MERCFunctions::ComputeERGain( 
-			edges.edges_[i].w_, 
-			loop[edges.edges_[i].a_]-edges.edges_[i].w_,
-			loop[edges.edges_[i].b_]-edges.edges_[i].w_);
-		int a = u->Find(  edges.edges_[i].a_ );
-		int b = u->Find(  edges.edges_[i].b_ );
-		if(a!=b)
-			bGainArr[i] = MERCFunctions::ComputeBGain(nVertices, u->rSize(a), u->rSize(b) );
+		edges.W(i) /= wT;
+	}
+
+	#pragma omp parallel for
+	for(int i=0;i<nVertices;i++)
+	{
+		loop[i] /= wT;
+	}
+	MERCGains gains(u,loop);
+
+	// the tiles are at least minTileSide pixels wide and high, smaller tiles
+	// have few or no edges inside them
+	const int minTileSide = 8;
+	int tilesX = 1,tilesY = 1;
+	if(width > 0)
+	{
+		tilesX = min(tilesX_, max(1, width/minTileSide));
+		tilesY = min(tilesY_, max(1, (nVertices/width)/minTileSide));
+	}
+
+	if(tilesX*tilesY > 1)
+	{
+		if(heapArity_ == 4)
+			ClusterTiles<4>(edges,u,gains,lambda,width,tilesX,tilesY,nC);
 		else
-			bGainArr[i] = 0;
-		if(erGainArr[i]>maxERGain)
-			maxERGain = erGainArr[i];
-		if(bGainArr[i]>maxBGain)
-			maxBGain = bGainArr[i];
+			ClusterTiles<2>(edges,u,gains,lambda,width,tilesX,tilesY,nC);
+		return;
+	}
+
+	// Heap
+	if(heapArity_ == 4)
+	{
+		MSubmodularHeap<4,G> heap(edges);
+		Merge(heap,edges,u,gains,lambda,nVertices,nC);
+	}
+	else
+	{
+		MSubmodularHeap<2,G> heap(edges);
+		Merge(heap,edges,u,gains,lambda,nVertices,nC);
+	}
+}
+
+template <int ARITY,class G>
+void MERCLazyGreedy::ClusterTiles(G &edges,MERCDisjointSet *u,MERCGains &gains,double lambda,int width,int tilesX,int tilesY,int nC)
+{
+	typedef MERCEdgeSubset<G> S;
+	typedef MSubmodularHeap<ARITY,S> H;
+
+	int nVertices = u->rNumVertices();
+	int height = nVertices/width;
+	int nTiles = tilesX*tilesY;
+	int nEdges = edges.rNumEdges();
+
+	// tile of each pixel
+	vector<int> tile(nVertices);
+	vector<int> pixels(nTiles,0);
+	for(int v=0;v<nVertices;v++)
+	{
+		tile[v] = ((v/width)*tilesY/height)*tilesX + (v%width)*tilesX/width;
+		pixels[ tile[v] ]++;
 	}
+
+	// indices of the edges in each tile, followed by the edges between tiles
+	vector<int> start(nTiles+3,0);
+	int a,b;
+	for(int i=0;i<nEdges;i++)
+	{
+		edges.Ends(i,a,b);
+		start[ (tile[a]==tile[b] ? tile[a] : nTiles) + 2 ]++;
+	}
+	for(int t=2;t<nTiles+2;t++)
+		start[t+1] += start[t];
+	vector<int> index(nEdges);
+	for(int i=0;i<nEdges;i++)
+	{
+		edges.Ends(i,a,b);
+		index[ start[ (tile[a]==tile[b] ? tile[a] : nTiles) + 1 ]++ ] = i;
+	}
+	vector<int>().swap(tile);
+	// &index[0] is not valid for a graph without edges
+	int *first = index.empty() ? NULL : &index[0];
+
+	// The clusters cut by the seams and the clusters that are too small next
+	// to them are merged by the last pass, so the tiles leave it more clusters
+	// than nC. The shares are rounded so that they add up.
+	long long nTileC = (long long)(tileFactor_*nC);
+	vector<int> budget(nTiles);
+	long long covered = 0;
+	for(int t=0;t<nTiles;t++)
+	{
+		long long first = (nTileC*covered + nVertices/2)/nVertices;
+		covered += pixels[t];
+		long long last = (nTileC*covered + nVertices/2)/nVertices;
+		budget[t] = max(1, (int)(last-first));
+	}
+
+	// the balancing weight is decided on all edges as for the whole graph,
+	// tiles without edges inside them get no heap and are left as they are
+	vector<H*> heaps(nTiles+1,(H*)NULL);
+	double maxERGain=0,maxBGain=1e-20;
+	#pragma omp parallel for schedule(dynamic)
+	for(int t=0;t<=nTiles;t++)
+	{
+		if(start[t+1] == start[t])
+			continue;
+		S subset(edges,first+start[t],start[t+1]-start[t]);
+		heaps[t] = new H(subset);
+		double er=0,b=1e-20;
+		InitialGains(*heaps[t],subset,u,gains,er,b);
+		#pragma omp critical
+		{
+			maxERGain = max(maxERGain,er);
+			maxBGain = max(maxBGain,b);
+		}
+	}
+	delete heaps[nTiles];
+	double balancing = lambda*maxERGain/std::abs(maxBGain);
+
+	// the merges of each tile are recorded one tile after the other
+	vector<MERCMergeTree> trees(tree_ ? nTiles : 0);
+	#pragma omp parallel for schedule(dynamic)
+	for(int t=0;t<nTiles;t++)
+	{
+		if(!heaps[t])
+			continue;
+		S subset(edges,first+start[t],start[t+1]-start[t]);
+		BalancingGains(*heaps[t],subset,u,gains,balancing);
+		Greedy(*heaps[t],subset,u,gains,balancing,pixels[t],budget[t],tree_ ? &trees[t] : NULL);
+		delete heaps[t];
+	}
+	for(unsigned int t=0;t<trees.size();t++)
+		tree_->Append(trees[t]);
+
+	// the last pass continues with the edges between different clusters, in
+	// a tile or across a seam, and their gains for the clusters of the tiles
+	int nBetween = 0;
+	for(int i=0;i<nEdges;i++)
+	{
+		edges.Ends(i,a,b);
+		if(u->Find(a) != u->Find(b))
+			index[nBetween++] = i;
+	}
+	S subset(edges,first,nBetween);
+	H heap(subset);
+	InitialGains(heap,subset,u,gains,maxERGain,maxBGain);
+	BalancingGains(heap,subset,u,gains,balancing);
+	Greedy(heap,subset,u,gains,balancing,u->rNumSets(),nC,tree_);
+}
+
+template <class H,class G>
+void MERCLazyGreedy::Merge(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double lambda,int nVertices,int nC)
+{
+	//
+	// Compute initial gain and decide the weighting on the balancing term,
+	// the heap holds the gains in the entropy rate term until it is known
+	//
+	double maxERGain=0,maxBGain=1e-20;
+	InitialGains(heap,edges,u,gains,maxERGain,maxBGain);
 	double balancing = lambda*maxERGain/std::abs(maxBGain);
 	//double balancing = lambda* log( 1.0*nVertices )/ log( 1.0*nC );
 
@@ -71,58 +258,86 @@ MERCDisjointSet* MERCLazyGreedy::ClusteringTree(int nVertices,MERCInput &edges,i
 	std::cout<<"Balancing gain = "<<balancing<<std::endl;
 	*/
 
+	BalancingGains(heap,edges,u,gains,balancing);
+	Greedy(heap,edges,u,gains,balancing,nVertices,nC,tree_);
+}
+
+template <class H,class G>
+void MERCLazyGreedy::InitialGains(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double &maxERGain,double &maxBGain)
+{
+	int nEdges = edges.rNumEdges();
+	int a,b,ea,eb;
+	double w;
 	for(int i=0;i<nEdges;i++)
 	{
-		edges.edges_[i].gain_ = erGainArr[i]+balancing*bGainArr[i];
+		edges.Ends(i,ea,eb);
+		w = edges.W(i);
+		double erGain = gains.ERGain( w, ea, eb);
+		heap.SetGain(i,erGain);
+		a = u->Find( ea );
+		b = u->Find( eb );
+		double bGain = 0;
+		if(a!=b)
+			bGain = gains.BGain( a, b );
+		if(erGain>maxERGain)
+			maxERGain = erGain;
+		if(bGain>maxBGain)
+			maxBGain = bGain;
 	}
-		
-	delete [] erGainArr;
-	delete [] bGainArr;
+}
 
-
-	// Heap
-	MSubmodularHeap<MERCEdge> heap((MERCEdge *)edges.edges_,nEdges);
+template <class H,class G>
+void MERCLazyGreedy::BalancingGains(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double balancing)
+{
+	int nEdges = edges.rNumEdges();
+	int a,b,ea,eb;
+	for(int i=0;i<nEdges;i++)
+	{
+		edges.Ends(i,ea,eb);
+		a = u->Find( ea );
+		b = u->Find( eb );
+		double bGain = 0;
+		if(a!=b)
+			bGain = gains.BGain( a, b );
+		heap.SetGain(i,heap.rGain(i)+balancing*bGain);
+	}
 	heap.BuildMaxHeap();
+}
 
+template <class H,class G>
+void MERCLazyGreedy::Greedy(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double balancing,int cc,int nC,MERCMergeTree *tree)
+{
 	//
 	// sequentially add edges to the graph and track cluster numbers and loop weights.
 	//
-	MERCEdge bestEdge;
-	double timeUsed = 0;
-	int cc = nVertices;
-	int a,b;
+	int a,b,ea,eb;
+	double w;
 
 	while( cc > nC )
 	{
 		if(heap.IsEmpty())
 		{
 			cout<<"Empty"<<endl;
-			delete [] loop;
-			return u;
+			return;
 		}
 		// find the best edge to add
-		bestEdge = heap.HeapExtractMax();
+		int best = heap.HeapExtractMax();
+		edges.Ends(best,ea,eb);
+		w = edges.W(best);
 
 		// insert the edge into the graph 
-		a = u->Find(  bestEdge.a_ );
-		b = u->Find(  bestEdge.b_ );
+		a = u->Find(  ea );
+		b = u->Find(  eb );
 
 		if(a!=b)
 		{
 			u->Join(a,b);
+			if(tree)
+				tree->Add(a,b);
 			cc--;
-			loop[bestEdge.a_] -= bestEdge.w_;
-			loop[bestEdge.b_] -= bestEdge.w_;
+			gains.AddEdge(w,ea,eb);
 		}
 
-		heap.EasyPartialUpdateTree(u,balancing,loop);
+		heap.EasyPartialUpdateTree(u,balancing,&gains,tolerance_);
 	}
-
-
-	delete [] loop;
-	//QueryPerformanceCounter(&t2);
-	//std::cout.precision(6);
-	//std::cout<<std::fixed<<"[TIME] "<<(t2.QuadPart - t1.QuadPart)/(f.QuadPart*1.0)<<" sec."<<std::endl;
-	
-	return u;
 }
\ No newline at end of file
@@ -24,13 +24,74 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #define _m_erclustering_lazy_greedy_h_
 
 #include "MERCClustering.h"
+#include "MERCMergeTree.h"
+#include "MERCGains.h"
+#include <assert.h>
 
 class MERCLazyGreedy: public MERCClustering
 {
 public:
 
+	MERCLazyGreedy();
+
 	// clustering with the cylce-free constraint
 	MERCDisjointSet* ClusteringTree(int nVertices,MERCInput &edges,int kernel,double sigma,double lambda,int nC);
+
+	// number of children of each node in the heap of edges, 2 or 4
+	void SetHeapArity(int arity) {assert(arity==2 || arity==4); heapArity_ = arity;};
+
+	// Approximate greedy: each merge takes an edge whose gain is at least
+	// (1-tolerance) times the largest one, which saves most of the updates of
+	// the heap after a merge. Zero, the default, gives the exact clustering.
+	void SetTolerance(double tolerance) {tolerance_ = tolerance;};
+
+	// record the merges of the following clusterings in tree, NULL to stop
+	void SetMergeTree(MERCMergeTree *tree) {tree_ = tree;};
+
+	// Cluster graphs over the pixels of an image in tilesX x tilesY tiles in
+	// parallel down to factor times their share of the clusters, then cluster
+	// the clusters of all tiles down to nC, see ClusterTiles. Tiles are at
+	// least 8 pixels wide and high, so small images get fewer tiles. Other
+	// graphs are clustered as a whole. A merge tree records the tiles one after the other,
+	// so only its clusterings with fewer than factor*nC clusters are balanced.
+	void SetTiles(int tilesX,int tilesY,double factor=3) {assert(tilesX>=1 && tilesY>=1); tilesX_ = tilesX; tilesY_ = tilesY; tileFactor_ = factor;};
+
+private:
+
+	int heapArity_;
+	double tolerance_;
+	MERCMergeTree *tree_;
+	int tilesX_;
+	int tilesY_;
+	double tileFactor_;
+
+	// normalize the weights and cluster the edges given by G, see MERCGraph.h,
+	// width is the width of the image if the vertices are its pixels or zero
+	template <class G>
+	void Cluster(G &edges,MERCDisjointSet *u,double *loop,double wT,double lambda,int width,int nVertices,int nC);
+
+	// Each tile is clustered like the whole graph, with the same balancing
+	// weight. The tiles share u and gains as their vertices are disjoint.
+	template <int ARITY,class G>
+	void ClusterTiles(G &edges,MERCDisjointSet *u,MERCGains &gains,double lambda,int width,int tilesX,int tilesY,int nC);
+
+	// compute the initial gains and add the edges with the largest gains until
+	// there are nC clusters
+	template <class H,class G>
+	void Merge(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double lambda,int nVertices,int nC);
+
+	// set the gains in the entropy rate term and update their maximum and the
+	// maximum gain in the balancing term
+	template <class H,class G>
+	void InitialGains(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double &maxERGain,double &maxBGain);
+
+	// add the weighted gains in the balancing term and build the heap
+	template <class H,class G>
+	void BalancingGains(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double balancing);
+
+	// add the edges with the largest gains until there are nC of the cc clusters
+	template <class H,class G>
+	void Greedy(H &heap,G &edges,MERCDisjointSet *u,MERCGains &gains,double balancing,int cc,int nC,MERCMergeTree *tree);
 };
 
 #endif
\ No newline at end of file
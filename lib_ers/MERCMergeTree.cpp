@@ -0,0 +1,120 @@
+#include "MERCMergeTree.h"
+#include "MERCOutput.h"
+#include <cstring>
+#include <algorithm>
+
+#define MERGE_TREE_MAGIC "ERST"
+#define MERGE_TREE_VERSION 2
+
+MERCMergeTree::MERCMergeTree()
+{
+	nVertices_ = 0;
+}
+
+void MERCMergeTree::Reset(int nVertices,const int *sizes)
+{
+	nVertices_ = nVertices;
+	if(sizes)
+		sizes_.assign(sizes, sizes + nVertices);
+	else
+		sizes_.clear();
+	merges_.clear();
+	merges_.reserve(2*nVertices);
+}
+
+MERCDisjointSet* MERCMergeTree::DisjointSet(int nC)
+{
+	MERCDisjointSet *u = new MERCDisjointSet(nVertices_, sizes_.empty() ? NULL : &sizes_[0]);
+
+	// Join picks the larger cluster as the root, so replaying the merges in
+	// order on the recorded sizes reproduces the cluster IDs
+	int nMerges = min(rNumMerges(), max(nVertices_ - nC, 0));
+	for(int i=0;i<nMerges;i++)
+		u->Join(merges_[2*i], merges_[2*i+1]);
+
+	return u;
+}
+
+vector<int> MERCMergeTree::Label(int nC)
+{
+	MERCDisjointSet *u = DisjointSet(nC);
+	vector<int> label = MERCOutput::DisjointSetToLabel(u);
+	delete u;
+	return label;
+}
+
+bool MERCMergeTree::Write(const char *filename)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if(!file.is_open())
+	{
+		cerr<<"Cannot open file "<<filename<<endl;
+		return false;
+	}
+
+	int header[4] = {MERGE_TREE_VERSION, nVertices_, rNumMerges(), sizes_.empty() ? 0 : 1};
+	file.write(MERGE_TREE_MAGIC, 4);
+	file.write((const char*) header, sizeof(header));
+	if(!sizes_.empty())
+		file.write((const char*) &sizes_[0], sizes_.size()*sizeof(int));
+	if(!merges_.empty())
+		file.write((const char*) &merges_[0], merges_.size()*sizeof(int));
+	file.close();
+	return true;
+}
+
+bool MERCMergeTree::Read(const char *filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if(!file.is_open())
+	{
+		cerr<<"Cannot open file "<<filename<<endl;
+		return false;
+	}
+
+	char magic[4];
+	int header[4] = {0, 0, 0, 0};
+	file.read(magic, 4);
+	file.read((char*) header, 3*sizeof(int));
+	if(file && header[0] == MERGE_TREE_VERSION)
+		file.read((char*) &header[3], sizeof(int));
+	if(!file || memcmp(magic, MERGE_TREE_MAGIC, 4) != 0 || header[0] < 1 || header[0] > MERGE_TREE_VERSION
+		|| header[1] < 0 || header[2] < 0 || header[2] >= max(header[1], 1) || header[3] < 0 || header[3] > 1)
+	{
+		cerr<<"Invalid merge tree "<<filename<<endl;
+		return false;
+	}
+
+	nVertices_ = header[1];
+	sizes_.resize(header[3] ? nVertices_ : 0);
+	if(!sizes_.empty())
+		file.read((char*) &sizes_[0], sizes_.size()*sizeof(int));
+	merges_.resize(2*header[2]);
+	if(!merges_.empty())
+		file.read((char*) &merges_[0], merges_.size()*sizeof(int));
+	if(!file)
+	{
+		cerr<<"Invalid merge tree "<<filename<<endl;
+		return false;
+	}
+
+	for(unsigned int i=0;i<sizes_.size();i++)
+	{
+		if(sizes_[i] < 1)
+		{
+			cerr<<"Invalid merge tree "<<filename<<endl;
+			return false;
+		}
+	}
+
+	// the IDs index the disjoint set
+	for(unsigned int i=0;i<merges_.size();i++)
+	{
+		if(merges_[i] < 0 || merges_[i] >= nVertices_)
+		{
+			cerr<<"Invalid merge tree "<<filename<<endl;
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,55 @@
+#ifndef _m_erc_merge_tree_h_
+#define _m_erc_merge_tree_h_
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include "MERCDisjointSet.h"
+using namespace std;
+
+// The sequence of merges of a greedy clustering, from which the clustering
+// with any number of clusters down to the final one can be recovered. All of
+// them share the balancing weight of the run that recorded the tree.
+class MERCMergeTree
+{
+public:
+	MERCMergeTree();
+
+	// start a new tree over nVertices single vertex clusters, with the given
+	// sizes of the vertices (e.g. the pixels of atoms) or NULL for size one
+	void Reset(int nVertices,const int *sizes=NULL);
+
+	// record that the clusters with IDs a and b were joined
+	void Add(int a,int b) {merges_.push_back(a); merges_.push_back(b);};
+
+	// record the merges of other after the merges of this tree
+	void Append(const MERCMergeTree &other) {merges_.insert(merges_.end(), other.merges_.begin(), other.merges_.end());};
+
+	// return the number of vertices
+	int rNumVertices() const {return nVertices_;};
+
+	// return the number of recorded merges
+	int rNumMerges() const {return (int)merges_.size()/2;};
+
+	// replay the merges down to nC clusters (or all merges if the tree ends
+	// earlier), the cluster IDs are the same as in the recording clustering
+	// since the vertices start with the same sizes
+	MERCDisjointSet* DisjointSet(int nC);
+
+	// label array with nC clusters, see MERCOutput::DisjointSetToLabel
+	vector<int> Label(int nC);
+
+	// Store the tree in binary form: the magic "ERST", the version, the number
+	// of vertices and merges and 1 if the sizes are stored (else 0) as 32-bit
+	// integers, then the sizes of the vertices and the pairs of cluster IDs.
+	// Read also accepts version 1, which has neither the flag nor the sizes.
+	bool Write(const char *filename);
+	bool Read(const char *filename);
+
+private:
+	int nVertices_;
+	vector<int> sizes_;
+	vector<int> merges_;
+};
+
+#endif
@@ -37,37 +37,35 @@ void MERCOutput::StoreClusteringMap(vector<int> &label,const char *filename)
 
 vector<int> MERCOutput::DisjointSetToLabel(MERCDisjointSet *u)
 {
-	int nSegments=0;
 	int segIndex = 0;
 	int nVertices = u->rNumVertices();
-	std::vector<int> *sarray = new std::vector<int> [nVertices];
 	vector<int> labeling(nVertices);
 
+	// the cluster ID of each vertex
 	for (int k=0; k<nVertices; k++) 
 	{
-	  int comp = u->Find(k);
-	  sarray[comp].push_back(k);
+		labeling[k] = u->Find(k);
 	}
-	
+
+	// number the clusters in the order of their IDs
+	vector<int> segment(nVertices,-1);
 	for(int k=0;k<nVertices;k++)
 	{
-		if(sarray[k].size() > 0)
-		{
-			nSegments++;
-		}
+		segment[labeling[k]] = 0;
 	}
 
 	for(int k=0;k<nVertices;k++)
 	{
-		if(sarray[k].size() > 0)
+		if(segment[k] == 0)
 		{
-			for(unsigned int j=0;j<sarray[k].size();j++)
-			{
-				labeling[sarray[k][j]] = segIndex;
-			}
+			segment[k] = segIndex;
 			segIndex++;
 		}
 	}
-	delete [] sarray;
+
+	for(int k=0;k<nVertices;k++)
+	{
+		labeling[k] = segment[labeling[k]];
+	}
 	return labeling;
 }
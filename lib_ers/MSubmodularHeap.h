@@ -22,30 +22,68 @@ OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 #ifndef _m_submodular_heap_h_
 #define _m_submodular_heap_h_
-#include "MMFunctions.h"
-#include "MHeap.h"
+#include "MERCGraph.h"
 #include "MERCDisjointSet.h"
-#include "MERCFunctions.h"
+#include "MERCGains.h"
 
 using namespace std;
 
-template <class T>
-class MSubmodularHeap: public MHeap<T> 
+// A max heap of edge indices ordered by the gains of the edges. The edges are
+// not copied, the heap keeps their 32-bit indices and, in a separate array at
+// the same positions, their gains, so that sifting compares contiguous gains
+// and moves an index and a gain per element instead of whole edges. ARITY is
+// the number of children of each node: the children of a 4-ary heap share a
+// cache line and the heap is half as deep, the binary heap makes the same
+// decisions as MHeap. G gives access to the edges, see MERCGraph.h, and the
+// gains are stored with the precision of its weights.
+template <int ARITY,class G>
+class MSubmodularHeap
 {
 public:
 
-	MSubmodularHeap(int length);
-	MSubmodularHeap(T *inarr,int length);
+	MSubmodularHeap(G &edges);
+	~MSubmodularHeap();
 
-	// An easy update version for tree structure
-	void EasyPartialUpdateTree(MERCDisjointSet *u,double balancingTerm,double *loop);
+	// Set the gain of edge i before BuildMaxHeap
+	void SetGain(int i,double gain) {key_[i] = gain;};
+
+	// Return the gain of edge i set before BuildMaxHeap
+	double rGain(int i) {return key_[i];};
+
+	// Build a max heap of all edges using their gains
+	void BuildMaxHeap();
+
+	// Remove the edge with the largest gain and return its index
+	int HeapExtractMax();
+
+	int HeapSize() {return nElements_;};
+
+	bool IsEmpty() { return nElements_==0; };
+
+	// An easy update version for tree structure. With a tolerance above zero
+	// the root is taken once its gain is at least (1-tolerance) times the
+	// largest gain in the heap instead of the largest one, see
+	// EasySubmodularMaxHeapifyTree.
+	void EasyPartialUpdateTree(MERCDisjointSet *u,double balancingTerm,MERCGains *gains,double tolerance=0);
 
 
 private:
 
+	G edges_;
+	unsigned int *heap_;			// edge indices, the root is heap_[0]
+	typename G::Weight *key_;		// gain of the edge heap_[i]
+	int nEdges_;
+	int nElements_;
+
 	MERCDisjointSet *u_;
-	double *loop_;
+	MERCGains *gains_;
 	double balancingTerm_;
+	double tolerance_;
+
+	void MaxHeapify(int i);
+
+	// largest gain of the children of the root, zero without children
+	typename G::Weight LargestChild();
 
 	// An easy update version for tree structure
 	int EasyUpdateValueTree(int i);
@@ -54,57 +92,154 @@ private:
 };
 
 
-template <class T>
-MSubmodularHeap<T>::MSubmodularHeap(int length): MHeap<T>(length) {}
+template <int ARITY,class G>
+MSubmodularHeap<ARITY,G>::MSubmodularHeap(G &edges) : edges_(edges)
+{
+	nEdges_ = edges_.rNumEdges();
+	nElements_ = 0;
+	heap_ = new unsigned int [nEdges_];
+	key_ = new typename G::Weight [nEdges_];
+	for(int i=0;i<nEdges_;i++)
+		heap_[i] = i;
+}
+
+template <int ARITY,class G>
+MSubmodularHeap<ARITY,G>::~MSubmodularHeap()
+{
+	delete [] heap_;
+	delete [] key_;
+}
+
+template <int ARITY,class G>
+void MSubmodularHeap<ARITY,G>::BuildMaxHeap()
+{
+	nElements_ = nEdges_;
+	// the last parent is the parent of the last element, none below two
+	// elements, where (nElements_-2)/ARITY would truncate to 0
+	for( int i=(nElements_>1 ? (nElements_-2)/ARITY : -1); i>=0 ; i--)
+		MaxHeapify(i);
+}
+
+template <int ARITY,class G>
+int MSubmodularHeap<ARITY,G>::HeapExtractMax()
+{
+	if( HeapSize() < 1)
+	{
+		std::cout<<"Heap underflow error"<<std::endl;
+		exit(0);
+	}
+	int maxElem = heap_[0];
+	heap_[0] = heap_[ HeapSize()-1 ];
+	key_[0] = key_[ HeapSize()-1 ];
+	nElements_--;
+	MaxHeapify(0);
+	return maxElem;
+}
+
+template <int ARITY,class G>
+void MSubmodularHeap<ARITY,G>::MaxHeapify(int i)
+{
+	// sift the element down, holding it aside instead of swapping
+	unsigned int e = heap_[i];
+	typename G::Weight gain = key_[i];
+	while(true)
+	{
+		int first = ARITY*i + 1;
+		if( first >= nElements_ )
+			break;
+
+		int last = first + ARITY;
+		if( last > nElements_ )
+			last = nElements_;
+
+		// the first child that is strictly larger than all before it
+		int largest = i;
+		typename G::Weight largestGain = gain;
+		for(int c=first;c<last;c++)
+		{
+			if( key_[c] > largestGain )
+			{
+				largest = c;
+				largestGain = key_[c];
+			}
+		}
 
-template <class T>
-MSubmodularHeap<T>::MSubmodularHeap(T *inarr,int length): MHeap<T>(inarr,length) {}
+		if( largest == i )
+			break;
+
+		heap_[i] = heap_[largest];
+		key_[i] = largestGain;
+		i = largest;
+	}
+	heap_[i] = e;
+	key_[i] = gain;
+}
 
 //==============================================================================
 // Fast update for tree structure
 //==============================================================================
-template <class T>
-void MSubmodularHeap<T>::EasyPartialUpdateTree(MERCDisjointSet *u,double balancingTerm,double *loop)
+template <int ARITY,class G>
+void MSubmodularHeap<ARITY,G>::EasyPartialUpdateTree(MERCDisjointSet *u,double balancingTerm,MERCGains *gains,double tolerance)
 {
 	// access to the disjoint set structure
 	u_ = u;
-	// keep track the loop value
-	loop_ = loop;
+	// keep track the loop value and its cached terms
+	gains_ = gains;
 	// copy the balancing parameter value.
 	balancingTerm_ = balancingTerm;
+	tolerance_ = tolerance;
 	
 	// A special heap update structure that utilize the submodular property.
 	EasySubmodularMaxHeapifyTree();
 }
 
-template <class T>
-void MSubmodularHeap<T>::EasySubmodularMaxHeapifyTree()
+template <int ARITY,class G>
+void MSubmodularHeap<ARITY,G>::EasySubmodularMaxHeapifyTree()
 {
 	//If the root node value is not updated, then update it
 	//If the root node value is updated, then it is the maximum value in the current heap.
 	//We don't need to update the other nodes because the dimnishing return property guarantees that the value can only be smaller.
-	while(EasyUpdateValueTree(1)==0)
+	while(!IsEmpty() && EasyUpdateValueTree(0)==0)
 	{
 		// If the edge form a loop, remove it from the loop and update the heap.
-		if(this->array_[1].gain_ == 0)
-			this->HeapExtractMax();
+		if(key_[0] == 0)
+			HeapExtractMax();
+		// The gains of the children bound all other gains, so a root that is
+		// still within the tolerance of them is good enough and is not moved.
+		else if(tolerance_ > 0 && key_[0] >= (1-tolerance_)*LargestChild())
+			break;
 		// Let insert the value into some correct place in the heap.
 		else
-			this->MaxHeapify(1); // find the maximum one through maxheapify
+			MaxHeapify(0); // find the maximum one through maxheapify
+	}
+}
+
+template <int ARITY,class G>
+typename G::Weight MSubmodularHeap<ARITY,G>::LargestChild()
+{
+	typename G::Weight largest = 0;
+	for(int c=1;c<=ARITY && c<nElements_;c++)
+	{
+		if( key_[c] > largest )
+			largest = key_[c];
 	}
+	return largest;
 }
 
 
-template <class T>
-int MSubmodularHeap<T>::EasyUpdateValueTree(int i)
+template <int ARITY,class G>
+int MSubmodularHeap<ARITY,G>::EasyUpdateValueTree(int i)
 {
 	double erGain,bGain;
+	int ea,eb;
+	edges_.Ends(heap_[i],ea,eb);
+	double w = edges_.W(heap_[i]);
 	// store the old gain
-	double oldGain = this->array_[i].gain_;
+	typename G::Weight oldGain = key_[i];
 
 	int a,b;
-	a = u_->Find(  this->array_[i].a_ );
-	b = u_->Find(  this->array_[i].b_ );
+	a = u_->Find(  ea );
+	b = u_->Find(  eb );
 	
 	
 
@@ -112,25 +247,23 @@ int MSubmodularHeap<T>::EasyUpdateValueTree(int i)
 	// Later, we will remove the zero edges from the heap.	
 	if( a==b )
 	{
-		this->array_[i].gain_ = 0;
+		key_[i] = 0;
 	}
 	else
 	{
 		// recompute the entropy rate gain
-		erGain = MERCFunctions::ComputeERGain( this->array_[i].w_, loop_[this->array_[i].a_]-this->array_[i].w_, loop_[this->array_[i].b_]-this->array_[i].w_);
+		erGain = gains_->ERGain( w, ea, eb);
 
 		// recomptue the balancing gain
-		bGain = MERCFunctions::ComputeBGain(u_->rNumVertices(), u_->rSize(a), u_->rSize(b) );
+		bGain = gains_->BGain( a, b );
 		
 
 		// compute the overall gain
-		this->array_[i].gain_ = erGain+balancingTerm_*bGain;
-		//array_[i].erGain_ = erGain;
-		//array_[i].bGain_ = bGain;
+		key_[i] = erGain+balancingTerm_*bGain;
 	}
 
 	// If the value is uptodate, we return one. (It will exit the while loop.)
-	if(oldGain==this->array_[i].gain_)
+	if(oldGain==key_[i])
 		return 1;
 	
 	// If it is not, then we return zero. (It will trigger another MaxHeapify.)
@@ -0,0 +1,50 @@
+#include "MERCLazyGreedy.h"
+#include "MERCInputImage.h"
+#include <cstdio>
+#include <cstdlib>
+
+// Clusters images that are too small for the requested tiles, down to 1x1
+// pixels, with both arities and both ways of storing the edges. The tiles
+// must not end up without edges and the clustering must reach its number of
+// superpixels.
+
+bool TestTiles(int width,int height,int tiles,int arity,bool compact,int nC)
+{
+	vector<unsigned char> data(width*height*3);
+	for(unsigned int i=0;i<data.size();i++)
+		data[i] = rand()%256;
+
+	MERCInputImage<RGBMap> input;
+	input.ReadImage(&data[0],width,height,width*3,3,1,5.0,compact);
+
+	MERCLazyGreedy merc;
+	merc.SetHeapArity(arity);
+	merc.SetTiles(tiles,tiles);
+	merc.ClusteringTreeIF(input.nNodes_,input,0,5.0,0.5*nC,nC);
+
+	int nSets = merc.disjointSet_->rNumSets();
+	if(nSets != nC)
+	{
+		std::cout<<width<<"x"<<height<<", "<<tiles<<"x"<<tiles<<" tiles, arity "<<arity
+			<<": "<<nSets<<" instead of "<<nC<<" superpixels"<<std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool passed = true;
+	for(int arity=2;arity<=4;arity+=2)
+	{
+		for(int compact=0;compact<=1;compact++)
+		{
+			passed = TestTiles(1,1,1,arity,compact,1) && passed;
+			passed = TestTiles(4,4,8,arity,compact,2) && passed;
+			passed = TestTiles(5,1,3,arity,compact,1) && passed;
+			passed = TestTiles(1,5,3,arity,compact,1) && passed;
+			passed = TestTiles(64,48,40,arity,compact,10) && passed;
+		}
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "MSubmodularHeap.h"
+#include <cstdio>
+#include <cstdlib>
+
+// Builds and drains heaps of 0 to 17 edges with both arities: the gains have
+// to come out in decreasing order and every edge exactly once.
+
+// edges without end points, the heap only needs their number to be built
+class TestEdges
+{
+public:
+	typedef double Weight;
+
+	TestEdges(int nEdges) : nEdges_(nEdges) {};
+
+	int rNumEdges() const {return nEdges_;};
+
+	void Ends(int i,int &a,int &b) const {a = 0; b = 0;};
+
+	Weight W(int i) {return 0;};
+
+private:
+	int nEdges_;
+};
+
+template <int ARITY>
+bool TestHeap(int nEdges)
+{
+	TestEdges edges(nEdges);
+	MSubmodularHeap<ARITY,TestEdges> heap(edges);
+	vector<double> gain(nEdges);
+	for(int i=0;i<nEdges;i++)
+	{
+		gain[i] = rand()%10;
+		heap.SetGain(i,gain[i]);
+	}
+	heap.BuildMaxHeap();
+
+	vector<bool> seen(nEdges,false);
+	double last = 1e20;
+	int extracted = 0;
+	while(!heap.IsEmpty())
+	{
+		int i = heap.HeapExtractMax();
+		if(i < 0 || i >= nEdges || seen[i] || gain[i] > last)
+		{
+			std::cout<<"Arity "<<ARITY<<", "<<nEdges<<" edges: wrong edge "<<i<<std::endl;
+			return false;
+		}
+		seen[i] = true;
+		last = gain[i];
+		extracted++;
+	}
+	if(extracted != nEdges)
+	{
+		std::cout<<"Arity "<<ARITY<<", "<<nEdges<<" edges: "<<extracted<<" extracted"<<std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool passed = true;
+	for(int nEdges=0;nEdges<=17;nEdges++)
+	{
+		passed = TestHeap<2>(nEdges) && passed;
+		passed = TestHeap<4>(nEdges) && passed;
+	}
+	return passed ? 0 : 1;
+}
@@ -29,16 +29,14 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <chrono>
 
-// Choose color space, LAB is better, HSV is faster (initialization).
-#define LAB_COLORSPACE
-//#define HSV_COLORSPACE
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-// Enables means post-processing
-// #define MEANS
-
-// Enables 3x3 smoothing prior
-#define PRIOR
+// The color space (LAB is better, HSV is faster), means post-processing and the
+// 3x3 smoothing prior are chosen at runtime, see the constructor.
 
 // If enabled, each block-updating level will be iterated twice.
 // Disable this to speed up the algorithm.
@@ -49,12 +47,143 @@
 
 #define MINIMUM_NR_SUBLABELS 1
 
+// Cost model used by plan, in seconds. Measured with 5 and 10 bins and 2 iterations
+// on images from 320x240 to 1920x1080, for all block sizes from 2x2 to 4x4 and 3 to
+// 7 levels (median error about 16%):
+// - per pixel (color conversion, labels and pixel updates),
+// - per stored histogram bin of all blocks (allocation and computation of the histograms),
+// - per stored histogram bin of the blocks along superpixel boundaries in each block update pass.
+#define COST_PIXEL 7.0e-8
+#define COST_HISTOGRAM 1.2e-8
+#define COST_BLOCK 1.3e-8
+
+// Configurations planned for a number of superpixels may deviate by this fraction.
+#define PLAN_TOLERANCE 0.1
+
+/**
+ * Number of superpixels (blocks at the top level) for the given image size, block
+ * size and number of levels, as set up by initialize.
+ * 
+ * @param width
+ * @param height
+ * @param seeds_w
+ * @param seeds_h
+ * @param nr_levels
+ * @return 
+ */
+int SEEDS::nr_superpixels(int width, int height, int seeds_w, int seeds_h, int nr_levels)
+{
+	int nr_w = width/seeds_w;
+	int nr_h = height/seeds_h;
+
+	for (int level=1; level<nr_levels; level++)
+	{
+		nr_w /= 2;
+		nr_h /= 2;
+	}
+
+	return nr_w*nr_h;
+}
+
+/**
+ * Predicts the runtime in seconds of initialize and iterate for the given
+ * configuration using the cost model defined by COST_PIXEL, COST_HISTOGRAM and
+ * COST_BLOCK. In each block update pass, mainly the blocks along the boundaries
+ * of the superpixels are exchanged, about sqrt(superpixels*blocks) at each level.
+ * Blocks stored sparsely (see compute_histograms) are counted with at most one bin
+ * per pixel.
+ * 
+ * @param width
+ * @param height
+ * @param nr_bins
+ * @param iterations
+ * @param seeds_w
+ * @param seeds_h
+ * @param nr_levels
+ * @return 
+ */
+double SEEDS::predict_runtime(int width, int height, int nr_bins, int iterations, int seeds_w, int seeds_h, int nr_levels)
+{
+	double histogram_size = nr_bins*nr_bins*nr_bins;
+	double superpixels = nr_superpixels(width, height, seeds_w, seeds_h, nr_levels);
+
+	double histograms = 0;
+	double boundary_bins = 0;
+	for (int level=0; level<nr_levels; level++)
+	{
+		double blocks = nr_superpixels(width, height, seeds_w, seeds_h, level + 1);
+		double pixels = seeds_w*seeds_h << 2*level;
+		double bins = (level < nr_levels - 1 && 2*pixels < histogram_size) ? pixels : histogram_size;
+
+		histograms += blocks*bins;
+		if (level < nr_levels - 1) boundary_bins += sqrt(superpixels*blocks)*bins;
+	}
+
+	return COST_PIXEL*width*height + COST_HISTOGRAM*histograms + COST_BLOCK*iterations*boundary_bins;
+}
+
+/**
+ * Plans a configuration for the given image size and number of superpixels.
+ * All block sizes from 2x2 to 4x4 (as used for the published configurations)
+ * and all numbers of levels of at least 3 are enumerated. Among those with
+ * a number of superpixels within PLAN_TOLERANCE of the requested one (or the
+ * closest, if there is none), the one with the lowest predicted runtime is
+ * chosen, see predict_runtime.
+ * 
+ * Returns false if the image is too small for any configuration.
+ * 
+ * @param width
+ * @param height
+ * @param nr_bins
+ * @param iterations
+ * @param superpixels
+ * @param seeds_w
+ * @param seeds_h
+ * @param nr_levels
+ * @return 
+ */
+bool SEEDS::plan(int width, int height, int nr_bins, int iterations, int superpixels, int& seeds_w, int& seeds_h, int& nr_levels)
+{
+	bool found = false;
+	int best_deviation = 0;
+	double best_runtime = 0;
+
+	for (int levels=3; nr_superpixels(width, height, 2, 2, levels) > 0; levels++)
+		for (int w=2; w<=4; w++)
+			for (int h=2; h<=4; h++)
+			{
+				int count = nr_superpixels(width, height, w, h, levels);
+				if (count <= 0) continue;
+
+				// All deviations within the tolerance are considered equal.
+				int deviation = abs(count - superpixels);
+				if (deviation <= PLAN_TOLERANCE*superpixels) deviation = 0;
+
+				double runtime = predict_runtime(width, height, nr_bins, iterations, w, h, levels);
+				if (!found || deviation < best_deviation || (deviation == best_deviation && runtime < best_runtime))
+				{
+					found = true;
+					best_deviation = deviation;
+					best_runtime = runtime;
+					seeds_w = w;
+					seeds_h = h;
+					nr_levels = levels;
+				}
+			}
+
+	return found;
+}
+
 /**
  * Main iteration method. Performs one (or a fixed number) iteration at each level
  * including the pixel level.
  * 
  * The iterative nature of SEEDS described in the paper is "lost" because the user
  * can not simply abort after each iteration without loosing too much quality.
+ * 
+ * A level (or the pixel level) is left early if a pass moves less blocks (pixels)
+ * than set by set_move_thresholds. The number of moves of each pass is recorded
+ * in block_moves and pixel_moves.
  */
 void SEEDS::iterate(int iterations) 
 {
@@ -64,7 +193,12 @@ void SEEDS::iterate(int iterations)
 	while (seeds_current_level >= 0)
 	{
                 for (int iteration = 0; iteration < iterations; ++iteration) {
-                        update_blocks(seeds_current_level);
+                        int moves = update_blocks(seeds_current_level);
+                        block_moves[seeds_current_level].push_back(moves);
+                        
+                        if (moves < min_block_moves) {
+                                break;
+                        }
                 }
                 
 		seeds_current_level = go_down_one_level();
@@ -72,17 +206,100 @@ void SEEDS::iterate(int iterations)
 
         // End with several pixel updates, that is exchange contour pixels between
         // neighbouring superpixels.
-	#ifdef MEANS
+	if (use_means)
+	{
 		compute_means();
+	}
                 
-                for (int iteration = 0; iteration < iterations; ++iteration) {
-                        update_pixels_means();
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+                int moves = update_pixels();
+                pixel_moves.push_back(moves);
+                
+                if (moves < min_pixel_moves) {
+                        break;
                 }
-	#else
+        }
+}
+
+/**
+ * Anytime version of iterate. Performs at most the given number of iterations at
+ * each level including the pixel level, but returns as soon as the given time
+ * budget (wall clock, in seconds) is used up. As SEEDS is a hill-climbing
+ * algorithm, labels[seeds_top_level] is a valid segmentation after every pass.
+ * 
+ * The remaining budget is split evenly among the remaining stages (the remaining
+ * block levels and the pixel level), time not used in one stage is passed on to
+ * the following stages. A pass is only started if, based on the duration of the
+ * last pass, it is expected to finish within the time of its stage.
+ * 
+ * Returns true if all iterations have been performed or all levels were left
+ * early because of the move thresholds, see set_move_thresholds.
+ * 
+ * @param iterations
+ * @param seconds
+ * @return 
+ */
+bool SEEDS::iterate(int iterations, double seconds)
+{
+	typedef std::chrono::steady_clock clock;
+
+	clock::time_point deadline = clock::now() 
+		+ std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+        
+        // Duration of the last pass, used to predict the duration of the next one.
+	clock::duration pass = clock::duration::zero();
+	int stages = seeds_current_level + 2;
+	bool complete = true;
+
+	while (seeds_current_level >= 0)
+	{
+		clock::time_point start = clock::now();
+		clock::time_point stage_deadline = start + (deadline - start)/stages;
+
                 for (int iteration = 0; iteration < iterations; ++iteration) {
-                        update_pixels();
+                        clock::time_point now = clock::now();
+                        if (now + pass > stage_deadline) {
+                                complete = false;
+                                break;
+                        }
+                        
+                        int moves = update_blocks(seeds_current_level);
+                        block_moves[seeds_current_level].push_back(moves);
+                        pass = clock::now() - now;
+                        
+                        if (moves < min_block_moves) {
+                                break;
+                        }
                 }
-	#endif
+                
+                // labels[seeds_top_level] is valid after each pass.
+		if (clock::now() >= deadline) return false;
+
+		seeds_current_level = go_down_one_level();
+		stages--;
+	}
+
+	if (use_means)
+	{
+		compute_means();
+	}
+                
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+                clock::time_point now = clock::now();
+                if (now + pass > deadline) {
+                        return false;
+                }
+                
+                int moves = update_pixels();
+                pixel_moves.push_back(moves);
+                pass = clock::now() - now;
+                
+                if (moves < min_pixel_moves) {
+                        break;
+                }
+        }
+
+	return complete;
 }
 
 /**
@@ -91,13 +308,21 @@ void SEEDS::iterate(int iterations)
  * Arguments define width and height of the image, the number of channels used,
  * the number of bins for the histograms.
  * 
+ * The variant of the algorithm is chosen by colorspace (LAB is better, HSV is faster),
+ * use_means (pixel updates based on the mean colors instead of the histograms [2])
+ * and use_prior (3x3 smoothing prior for pixel updates). The pixel updates are
+ * instantiated for each combination such that there is no per pixel overhead.
+ * 
  * @param width
  * @param height
  * @param nr_channels
  * @param nr_bins
  * @param min_size
+ * @param colorspace
+ * @param use_means
+ * @param use_prior
  */
-SEEDS::SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size)
+SEEDS::SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size, ColorSpace colorspace, bool use_means, bool use_prior)
 {
 	this->width = width;
 	this->height = height;
@@ -105,6 +330,9 @@ SEEDS::SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size)
 	this->nr_bins = nr_bins;
 	this->merge_threshold = merge_threshold;
 	this->min_size = min_size;
+	this->colorspace = colorspace;
+	this->use_means = use_means;
+	this->use_prior = use_prior;
 
 	image_bins = new UINT[width*height];
 	image_l = new float[width*height];
@@ -112,9 +340,20 @@ SEEDS::SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size)
 	image_b = new float[width*height];
 	edge_w = new float[width*height];
 	edge_h = new float[width*height];
+	bin_cutoff1 = new float[nr_bins];
+	bin_cutoff2 = new float[nr_bins];
+	bin_cutoff3 = new float[nr_bins];
+	means = NULL;
+	min_block_moves = 0;
+	min_pixel_moves = 0;
+	take_snapshots = false;
+	masked = false;
+	boundaries_valid = false;
 	forwardbackward = true;
 	histogram_size = nr_bins*nr_bins*nr_bins;
 	initialized = false;
+
+	build_topology();
 }
 
 /**
@@ -129,16 +368,37 @@ SEEDS::~SEEDS()
 	delete[] image_b;
 	delete[] edge_w;
 	delete[] edge_h;
+	delete[] bin_cutoff1;
+	delete[] bin_cutoff2;
+	delete[] bin_cutoff3;
+	delete[] means;
+
+	release();
+}
 
+/**
+ * Frees all arrays depending on the block structure, that is on seeds_w, seeds_h
+ * and the number of levels. These arrays are allocated in the first call of
+ * initialize and kept as long as the block structure does not change.
+ */
+void SEEDS::release()
+{
 	if (initialized)
 	{
 		for (int level=0; level<seeds_nr_levels; level++)
 		{
-			for (int label=0; label<nr_labels[level]; label++)
+			if (!sparse[level])
 			{
-				delete[] histogram[level][label];
+				for (int label=0; label<nr_labels[level]; label++)
+				{
+					delete[] histogram[level][label];
+				}
 			}
 			delete[]  histogram[level];
+			delete[] entry_start[level];
+			delete[] nr_entries[level];
+			delete[] entry_bins[level];
+			delete[] entry_counts[level];
 			delete[] T[level];
 			delete[] labels[level];
 			delete[] parent[level];
@@ -146,6 +406,11 @@ SEEDS::~SEEDS()
 
 		}
 		delete[] histogram;
+		delete[] sparse;
+		delete[] entry_start;
+		delete[] nr_entries;
+		delete[] entry_bins;
+		delete[] entry_counts;
 		delete[] T;
 		delete[] labels;
 		delete[] parent;
@@ -153,16 +418,69 @@ SEEDS::~SEEDS()
 		delete[] nr_labels;
 		delete[] nr_w;
 		delete[] nr_h;
-		delete[] bin_cutoff1;
-		delete[] bin_cutoff2;
-		delete[] bin_cutoff3;
-
-		#ifdef MEANS
 		delete[] L_channel;
 		delete[] A_channel;
 		delete[] B_channel;
-		#endif
+
+		initialized = false;
+	}
+}
+
+/**
+ * Sets the thresholds for early stopping. A block level is left as soon as an
+ * iteration moves less than min_block_moves blocks, the pixel updates are stopped
+ * as soon as an iteration moves less than min_pixel_moves pixels.
+ * 
+ * The default of zero never stops early. With a threshold of one, a block level is
+ * left once it has converged, which does not change the result.
+ * 
+ * @param min_block_moves
+ * @param min_pixel_moves
+ */
+void SEEDS::set_move_thresholds(int min_block_moves, int min_pixel_moves)
+{
+	this->min_block_moves = min_block_moves;
+	this->min_pixel_moves = min_pixel_moves;
+}
+
+/**
+ * Enables or disables snapshots of the segmentation. If enabled, the segmentation
+ * after the block updates at each level is kept when leaving the level, so the
+ * segmentations of all levels are available after a single call to iterate, see
+ * get_snapshot. Only the superpixel of each block at level 0 is stored per level.
+ * 
+ * The blocks of every level belong to the same top level superpixels, so all
+ * snapshots have the same number of superpixels. They only differ in how finely
+ * the boundaries follow the image: along the blocks of their level.
+ * 
+ * No snapshots are taken for the frames given to initialize_next.
+ * 
+ * @param enabled
+ */
+void SEEDS::set_snapshots(bool enabled)
+{
+	take_snapshots = enabled;
+}
+
+/**
+ * Writes the segmentation after the block updates at the given level to the
+ * given array of size width*height. Returns false if there is no snapshot for
+ * this level, for example because iterate stopped at the deadline before.
+ * 
+ * @param level
+ * @param snapshot_labels
+ * @return 
+ */
+bool SEEDS::get_snapshot(int level, UINT* snapshot_labels)
+{
+	if (!initialized || level < 0 || level >= seeds_nr_levels || snapshots[level].empty()) return false;
+
+	for (int i=0; i<width*height; i++)
+	{
+		snapshot_labels[i] = snapshots[level][labels[0][i]];
 	}
+
+	return true;
 }
 
 /**
@@ -172,6 +490,10 @@ SEEDS::~SEEDS()
  * such that nr_levels defines how often the size of the smallest blocks are doubled to
  * get the superpixel size.
  * 
+ * initialize may be called repeatedly to process several images of the same size.
+ * As long as seeds_w, seeds_h and nr_levels do not change, all arrays are reused
+ * and no memory is allocated.
+ * 
  * @param image
  * @param seeds_w
  * @param seeds_h
@@ -179,7 +501,19 @@ SEEDS::~SEEDS()
  */
 void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
 {
-	iteration = 0;
+        // All buffers of the previous initialization are reused if the block
+        // structure did not change.
+	if (initialized && (seeds_w != this->seeds_w || seeds_h != this->seeds_h || nr_levels != seeds_nr_levels))
+	{
+		release();
+	}
+
+	forwardbackward = true;
+	masked = false;
+	boundaries_valid = false;
+	block_moves.assign(nr_levels, vector<int>());
+	snapshots.assign(nr_levels, vector<UINT>());
+	pixel_moves.clear();
 
 	this->seeds_w = seeds_w;
 	this->seeds_h = seeds_h;
@@ -194,9 +528,10 @@ void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
         // at each level.
 	assign_labels();
 	
-	#ifdef LAB_COLORSPACE
+	if (colorspace == LAB)
+	{
 		lab_get_histogram_cutoff_values(image);
-	#endif
+	}
 
 	// Convert the image into LAB or
 	for (int x=0; x<width; x++)
@@ -209,18 +544,20 @@ void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
 			float L;
 			float A;
 			float B;
-			#ifdef LAB_COLORSPACE
+			if (colorspace == LAB)
+			{
 				image_bins[i] = RGB2LAB_special(r, g, b, &L, &A, &B);
 				image_l[i] = L/100.0;
 				image_a[i] = (A+128.0)/255.0;
 				image_b[i] = (B+128.0)/255.0;
-			#endif
-			#ifdef HSV_COLORSPACE
+			}
+			else
+			{
 				image_bins[i] = RGB2HSV(r, g, b, &L, &A, &B);
                                 image_l[i] = L;
 				image_a[i] = A;
 				image_b[i] = B;
-			#endif
+			}
 		}
 
 	compute_histograms();
@@ -231,6 +568,11 @@ void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
 /**
  * Initialize the algorithm using an OpenCV Matrix.
  * 
+ * The image is expected to be an 8-bit image with one (gray), three (BGR) or four
+ * (BGRA) channels as returned by cv::imread. The rows are read directly from
+ * the matrix in raster order, so arbitrary row strides (e.g. ROIs) are supported
+ * and no intermediate copy of the image is needed.
+ * 
  * @param image
  * @param seeds_w
  * @param seeds_h
@@ -238,7 +580,17 @@ void SEEDS::initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels)
  */
 void SEEDS::initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_levels)
 {
-	iteration = 0;
+	if (initialized && (seeds_w != this->seeds_w || seeds_h != this->seeds_h || nr_levels != seeds_nr_levels))
+	{
+		release();
+	}
+
+	forwardbackward = true;
+	masked = false;
+	boundaries_valid = false;
+	block_moves.assign(nr_levels, vector<int>());
+	snapshots.assign(nr_levels, vector<UINT>());
+	pixel_moves.clear();
 
 	this->seeds_w = seeds_w;
 	this->seeds_h = seeds_h;
@@ -252,41 +604,173 @@ void SEEDS::initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_le
 	// Assign the labels and set up arrays to manage the labels
         // at each level.
 	assign_labels();
-	
-	#ifdef LAB_COLORSPACE
-		lab_get_histogram_cutoff_values(image);
-	#endif
 
-	// Convert the image into LAB or
-	for (int x=0; x<width; x++)
+	int channels = image.channels();
+
+	if (colorspace == LAB)
+	{
+		// First pass: convert each row to LAB, the unnormalized values are
+                // stored in image_l, image_a and image_b.
 		for (int y=0; y<height; y++)
 		{
-			int i = y*width + x;
-			int b = image.at<cv::Vec3b>(y, x)[0];
-			int g = image.at<cv::Vec3b>(y, x)[0];
-			int r = image.at<cv::Vec3b>(y, x)[0];
-			float L;
-			float A;
-			float B;
-			#ifdef LAB_COLORSPACE
-				image_bins[i] = RGB2LAB_special(r, g, b, &L, &A, &B);
-				image_l[i] = L/100.0;
-				image_a[i] = (A+128.0)/255.0;
-				image_b[i] = (B+128.0)/255.0;
-			#endif
-			#ifdef HSV_COLORSPACE
-				image_bins[i] = RGB2HSV(r, g, b, &L, &A, &B);
-                                image_l[i] = L;
-				image_a[i] = A;
-				image_b[i] = B;
-			#endif
+			RGB2LAB_row(image.ptr<uchar>(y), channels, image_l + y*width, image_a + y*width, image_b + y*width);
+		}
+
+                // The histogram cutoff values are sampled from the converted image
+                // such that the cutoffs and the bins are consistent.
+		lab_get_histogram_cutoff_values();
+
+                // Second pass: assign the bins and normalize the channels.
+		for (int y=0; y<height; y++)
+		{
+			LAB2bin_row(image_l + y*width, image_a + y*width, image_b + y*width, image_bins + y*width);
+		}
+	}
+	else
+	{
+		for (int y=0; y<height; y++)
+		{
+			const uchar* row = image.ptr<uchar>(y);
+			for (int x=0; x<width; x++)
+			{
+				int i = y*width + x;
+				int b = row[x*channels];
+				int g = (channels >= 3) ? row[x*channels + 1] : b;
+				int r = (channels >= 3) ? row[x*channels + 2] : b;
+				float H;
+				float S;
+				float V;
+				image_bins[i] = RGB2HSV(r, g, b, &H, &S, &V);
+				image_l[i] = H;
+				image_a[i] = S;
+				image_b[i] = V;
+			}
 		}
+	}
 
 	compute_histograms();
 
 	initialized = true;
 }
 
+/**
+ * Initialize the algorithm with the next frame of a video.
+ * 
+ * Instead of starting from the regular block grid, the block-to-superpixel assignment
+ * (parent at level 0), the superpixels and the histogram cutoffs of the previous frame
+ * are kept. Only pixels whose color (normalized to [0,1] per channel) changed by more
+ * than threshold are re-binned, and the histograms at level 0 and at the top level are
+ * updated accordingly. The histograms of the intermediate levels are not maintained.
+ * 
+ * Blocks containing changed pixels and their neighbouring blocks are marked active.
+ * Within active blocks the pixels are reset to the superpixel of their block, and
+ * the next call of iterate only performs block updates at level 0 and pixel updates
+ * within active blocks. All other pixels keep their labels such that the labels
+ * are consistent over frames.
+ * 
+ * The image has to have the same size as the one given to initialize, which has
+ * to be called for the first frame. Returns the number of changed pixels, or -1
+ * if initialize has not been called.
+ * 
+ * @param image
+ * @param threshold
+ * @return 
+ */
+int SEEDS::initialize_next(const cv::Mat &image, float threshold)
+{
+	if (!initialized) return -1;
+
+	forwardbackward = true;
+	block_moves.assign(seeds_nr_levels, vector<int>());
+	snapshots.assign(seeds_nr_levels, vector<UINT>());
+	pixel_moves.clear();
+
+	int nr_blocks = nr_labels[0];
+	changed_blocks.assign(nr_blocks, 0);
+	block_mask.assign(nr_blocks, 0);
+	row_l.resize(width);
+	row_a.resize(width);
+	row_b.resize(width);
+	row_bins.resize(width);
+
+	int channels = image.channels();
+	int changed = 0;
+
+	for (int y=0; y<height; y++)
+	{
+		// Convert the row using the cutoffs of the first frame.
+		if (colorspace == LAB)
+		{
+			RGB2LAB_row(image.ptr<uchar>(y), channels, &row_l[0], &row_a[0], &row_b[0]);
+			LAB2bin_row(&row_l[0], &row_a[0], &row_b[0], &row_bins[0]);
+		}
+		else
+		{
+			const uchar* row = image.ptr<uchar>(y);
+			for (int x=0; x<width; x++)
+			{
+				int b = row[x*channels];
+				int g = (channels >= 3) ? row[x*channels + 1] : b;
+				int r = (channels >= 3) ? row[x*channels + 2] : b;
+				row_bins[x] = RGB2HSV(r, g, b, &row_l[x], &row_a[x], &row_b[x]);
+			}
+		}
+
+		for (int x=0; x<width; x++)
+		{
+			int i = y*width + x;
+			if (fabs(row_l[x] - image_l[i]) <= threshold 
+				&& fabs(row_a[x] - image_a[i]) <= threshold 
+				&& fabs(row_b[x] - image_b[i]) <= threshold)
+			{
+				continue;
+			}
+
+			// Move the pixel to its new bin.
+			delete_pixel(0, labels[0][i], x, y);
+			delete_pixel(seeds_top_level, labels[seeds_top_level][i], x, y);
+			image_bins[i] = row_bins[x];
+			image_l[i] = row_l[x];
+			image_a[i] = row_a[x];
+			image_b[i] = row_b[x];
+			add_pixel(0, labels[0][i], x, y);
+			add_pixel(seeds_top_level, labels[seeds_top_level][i], x, y);
+
+			changed_blocks[labels[0][i]] = 1;
+			changed++;
+		}
+	}
+
+	// Active blocks are the changed blocks and their neighbours.
+	for (int by=0; by<nr_h[0]; by++)
+		for (int bx=0; bx<nr_w[0]; bx++)
+		{
+			if (!changed_blocks[by*nr_w[0] + bx]) continue;
+
+			for (int dy=max(by-1, 0); dy<=min(by+1, nr_h[0]-1); dy++)
+				for (int dx=max(bx-1, 0); dx<=min(bx+1, nr_w[0]-1); dx++)
+					block_mask[dy*nr_w[0] + dx] = 1;
+		}
+
+	// Within active blocks, the pixel updates of the last frame are undone such that
+        // the blocks can be moved using add_block and delete_block.
+	for (int y=0; y<height; y++)
+		for (int x=0; x<width; x++)
+		{
+			int i = y*width + x;
+			if (block_mask[labels[0][i]] && labels[seeds_top_level][i] != parent[0][labels[0][i]])
+			{
+				update<false>(seeds_top_level, parent[0][labels[0][i]], x, y);
+			}
+		}
+
+	seeds_current_level = 0;
+	masked = true;
+	boundaries_valid = false;
+
+	return changed;
+}
+
 /**
  * Called in initialize, the method initializes all arrays needed to managing the labels 
  * on all levels:
@@ -300,40 +784,65 @@ void SEEDS::initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_le
  */
 void SEEDS::assign_labels()
 {
-        // Two dimensional array to assign each pixel a label at each level: labels[seeds_nr_levels][width*height].
-	labels = new UINT*[seeds_nr_levels];
-        
-        // Two dimensional array containing the superpixel label for each pixel on the current level.
-	parent = new UINT*[seeds_nr_levels];
-        
-        // Counts the number of subblocks a label at level l can be divided into.
-        // This is managed in add_block and delete_block.
-	nr_partitions = new UINT*[seeds_nr_levels];
-        
-        // Contains the total number of labels at each level.
-	nr_labels = new UINT[seeds_nr_levels];
-        
-        // Arrays to contain the number of blocks in x and y direction, respectively.
-	nr_w = new int[seeds_nr_levels];
-	nr_h = new int[seeds_nr_levels];
+	// The arrays are only allocated in the first initialization, afterwards
+        // they are reused, see initialize.
+	if (!initialized)
+	{
+                // Two dimensional array to assign each pixel a label at each level: labels[seeds_nr_levels][width*height].
+                // Only level 0 and the top level are stored, the labels at the remaining
+                // levels are derived from the block at level 0, see block_label.
+		labels = new UINT*[seeds_nr_levels];
+                
+                // Two dimensional array containing the superpixel label for each pixel on the current level.
+		parent = new UINT*[seeds_nr_levels];
+                
+                // Counts the number of subblocks a label at level l can be divided into.
+                // This is managed in add_block and delete_block.
+		nr_partitions = new UINT*[seeds_nr_levels];
+                
+                // Contains the total number of labels at each level.
+		nr_labels = new UINT[seeds_nr_levels];
+                
+                // Arrays to contain the number of blocks in x and y direction, respectively.
+		nr_w = new int[seeds_nr_levels];
+		nr_h = new int[seeds_nr_levels];
+
+                // In each level, the size of the blocks is doubled (both width and height)
+                // such that a block at level l is subdivided into 4 block at level l-1.
+		for (int level=0; level<seeds_nr_levels; level++)
+		{
+			nr_w[level] = (level == 0) ? floor(width/seeds_w) : nr_w[level-1]/2;
+			nr_h[level] = (level == 0) ? floor(height/seeds_h) : nr_h[level-1]/2;
+			nr_labels[level] = nr_w[level]*nr_h[level];
+
+			labels[level] = (level == 0 && seeds_top_level > 0) ? new UINT[width*height] : NULL;
+			parent[level] = new UINT[nr_labels[level]];
+			nr_partitions[level] = new UINT[nr_labels[level]];
+		}
+
+                // The neighbourhoods used in update_pixels reach up to one row and
+                // two pixels beyond the image, these are padded with an invalid label.
+		labels[seeds_top_level] = new UINT[width*height + width + 2];
+		for (int i=width*height; i<width*height + width + 2; i++)
+		{
+			labels[seeds_top_level][i] = -1;
+		}
+
+		L_channel = new float[nr_labels[seeds_top_level]];
+		A_channel = new float[nr_labels[seeds_top_level]];
+		B_channel = new float[nr_labels[seeds_top_level]];
+	}
 
 	// Base level: 0.
 	int level = 0;
-	int nr_seeds_w = floor(width/seeds_w);
-	int nr_seeds_h = floor(height/seeds_h);
+	int nr_seeds_w = nr_w[level];
+	int nr_seeds_h = nr_h[level];
         
         // Blocks have size seeds_w x seeds_h.
 	int step_w = seeds_w;
 	int step_h = seeds_h;
 	int nr_seeds = nr_seeds_w*nr_seeds_h;
         
-	nr_labels[level] = nr_seeds;
-	nr_w[level] = nr_seeds_w;
-	nr_h[level] = nr_seeds_h;
-	labels[level] = new UINT[width*height];
-	parent[level] = new UINT[nr_seeds];
-	nr_partitions[level] = new UINT[nr_seeds];
-        
         // At base level there is no further partitioning, each pixel
         // contains exactly one pixel.
 	for (int i=0; i<nr_seeds; i++) nr_partitions[level][i] = 1;
@@ -353,50 +862,64 @@ void SEEDS::assign_labels()
 			// parents will be set in the next loop
 		}
 
+	for (int i=0; i<width*height; i++)
+	{
+		labels[seeds_top_level][i] = block_label(seeds_top_level, labels[0][i]);
+	}
+
 	for (int level = 1; level < seeds_nr_levels; level++)
 	{
-                // In each level, the size of the blocks is doubled (both width and height)
-                // such that a block at level l is subdivided into 4 block at level l-1.
-		nr_seeds_w /= 2;
-		nr_seeds_h /= 2;
-		step_w *= 2;
-		step_h *= 2;
-		nr_seeds = nr_seeds_w*nr_seeds_h;
-                
-		nr_labels[level] = nr_seeds;
-		nr_w[level] = nr_seeds_w;
-		nr_h[level] = nr_seeds_h;
-		labels[level] = new UINT[width*height];
-		parent[level] = new UINT[nr_seeds];
-		nr_partitions[level] = new UINT[nr_seeds];
-                
                 // nr_partitions is managed in add_block and delete_block, so
                 // just initialize with zero.
-		for (int i=0; i<nr_seeds; i++) nr_partitions[level][i] = 0;
+		for (int i=0; i<nr_labels[level]; i++) nr_partitions[level][i] = 0;
                 
-		for (int y=0; y<height; y++)
-			for (int x=0; x<width; x++)
-			{
-				int label_x = floor((float)x/step_w);
-				if (label_x >= nr_seeds_w) label_x = nr_seeds_w-1;
-				int label_y = floor((float)y/step_h);
-				if (label_y >= nr_seeds_h) label_y = nr_seeds_h-1;
-				labels[level][y*width+x] = label_y*nr_seeds_w + label_x;
-                                
-                                // Set the superpixel label for each pixel in this level.
-				parent[level-1][labels[level-1][y*width+x]] = labels[level][y*width+x];
-			}
+                // Set the label at this level for each block at the level below.
+		for (int label=0; label<nr_labels[0]; label++)
+		{
+			parent[level-1][block_label(level-1, label)] = block_label(level, label);
+		}
 	}
 
 	seeds_top_level = seeds_nr_levels - 1;
 }
 
+/**
+ * Returns the superpixel of the given block at the given level, the neighbourhoods
+ * used in update_blocks may reach beyond the first and last row of blocks, these
+ * blocks are assigned -1.
+ * 
+ * @param level
+ * @param label
+ * @return 
+ */
+int SEEDS::block_parent(int level, int label)
+{
+	return (label >= 0 && label < nr_labels[level]) ? parent[level][label] : -1;
+}
+
+/**
+ * Returns the label of the block at the given level containing the given block
+ * at level 0. Blocks at level l consist of 2x2 blocks at level l-1, where the blocks
+ * in the last row and column additionally contain the remaining blocks.
+ * 
+ * @param level
+ * @param label
+ * @return 
+ */
+int SEEDS::block_label(int level, int label)
+{
+	int label_x = min((label % nr_w[0]) >> level, nr_w[level] - 1);
+	int label_y = min((label / nr_w[0]) >> level, nr_h[level] - 1);
+	return label_y*nr_w[level] + label_x;
+}
+
 void SEEDS::lab_get_histogram_cutoff_values(UINT* image)
 {
-	// get image lists and histogram cutoff values
-	vector<float> list_channel1;
-	vector<float> list_channel2;
-	vector<float> list_channel3;
+	// get image lists and histogram cutoff values, the lists are kept
+        // as members to avoid reallocation when reinitializing
+	list_channel1.clear();
+	list_channel2.clear();
+	list_channel3.clear();
 	vector<float>::iterator it;
 	int samp = 5;
 	int ctr = 0;
@@ -416,9 +939,6 @@ void SEEDS::lab_get_histogram_cutoff_values(UINT* image)
 			list_channel3.push_back(B);
 			ctr++;
 		}
-	bin_cutoff1 = new float[nr_bins];
-	bin_cutoff2 = new float[nr_bins];
-	bin_cutoff3 = new float[nr_bins];
 	for (int i=1; i<nr_bins; i++)
 	{
 		int N = (int) floor((float) (i*ctr)/ (float)nr_bins);
@@ -437,34 +957,31 @@ void SEEDS::lab_get_histogram_cutoff_values(UINT* image)
 	bin_cutoff3[nr_bins-1] = 300;
 }
 
-void SEEDS::lab_get_histogram_cutoff_values(const cv::Mat &image)
+/**
+ * Computes the histogram cutoff values from the unnormalized LAB values already
+ * stored in image_l, image_a and image_b, see RGB2LAB_row. As in
+ * lab_get_histogram_cutoff_values(UINT*) every fifth pixel in both directions
+ * is sampled.
+ */
+void SEEDS::lab_get_histogram_cutoff_values()
 {
-	// get image lists and histogram cutoff values
-	vector<float> list_channel1;
-	vector<float> list_channel2;
-	vector<float> list_channel3;
+	// get image lists and histogram cutoff values, the lists are kept
+        // as members to avoid reallocation when reinitializing
+	list_channel1.clear();
+	list_channel2.clear();
+	list_channel3.clear();
 	vector<float>::iterator it;
 	int samp = 5;
 	int ctr = 0;
-	for (int x=0; x<width; x+=samp)
-		for (int y=0; y<height; y+=samp)
+	for (int y=0; y<height; y+=samp)
+		for (int x=0; x<width; x+=samp)
 		{
 			int i = y*width +x;
-                        int b = image.at<cv::Vec3b>(y, x)[0];
-                        int g = image.at<cv::Vec3b>(y, x)[1];
-                        int r = image.at<cv::Vec3b>(y, x)[2];
-			float L = 0;
-			float A = 0;
-			float B = 0;
-			RGB2LAB(r, g, b, &L, &A, &B);
-			list_channel1.push_back(L);
-			list_channel2.push_back(A);
-			list_channel3.push_back(B);
+			list_channel1.push_back(image_l[i]);
+			list_channel2.push_back(image_a[i]);
+			list_channel3.push_back(image_b[i]);
 			ctr++;
 		}
-	bin_cutoff1 = new float[nr_bins];
-	bin_cutoff2 = new float[nr_bins];
-	bin_cutoff3 = new float[nr_bins];
 	for (int i=1; i<nr_bins; i++)
 	{
 		int N = (int) floor((float) (i*ctr)/ (float)nr_bins);
@@ -491,10 +1008,6 @@ void SEEDS::lab_get_histogram_cutoff_values(const cv::Mat &image)
  */
 void SEEDS::compute_means()
 {
-	L_channel = new float[nr_labels[seeds_top_level]];
-	A_channel = new float[nr_labels[seeds_top_level]];
-	B_channel = new float[nr_labels[seeds_top_level]];
-
 	// clear counted LAB values
 	for (int label=0; label<nr_labels[seeds_top_level]; label++)
 	{
@@ -515,7 +1028,7 @@ void SEEDS::compute_means()
 }
 
 /**
- * Histograms are initialized in the first iteration and built up layer wise,
+ * Histograms are allocated in the first initialization and built up layer wise,
  * beginning with the first block level.
  * 
  * The histograms are built using add_pixel and add_block as they automatically
@@ -530,82 +1043,245 @@ void SEEDS::compute_histograms(int until_level)
 	if (until_level == -1) until_level = seeds_nr_levels - 1;
 	until_level++;
 
-	// Initialize the histrograms in the first iteration.
-	if (iteration == 0)
+	// Allocate the histrograms in the first initialization.
+	if (!initialized)
 	{
                 // Histograms are initialized for each label in each level: histogram[level][label][bin].
 		histogram = new int**[seeds_nr_levels];
                 
                 
 		T = new int*[seeds_nr_levels]; // block sizes are kept at each level [level][label]
+		sparse = new bool[seeds_nr_levels];
+		entry_start = new int*[seeds_nr_levels];
+		nr_entries = new int*[seeds_nr_levels];
+		entry_bins = new int*[seeds_nr_levels];
+		entry_counts = new int*[seeds_nr_levels];
+
+                // A block can use at most as many bins as it has pixels, the number of
+                // pixels of each block is counted along the parents.
+		vector<int> pixels(nr_labels[0], 0);
+		for (int i=0; i<width*height; i++) pixels[labels[0][i]]++;
+
 		for (int level=0; level<seeds_nr_levels; level++)
 		{
-			histogram[level] = new int*[nr_labels[level]];
-                        
                         // Block sizes are kept at each level: T[level][label].
 			T[level] = new int[nr_labels[level]]; 
-			for (int label=0; label<nr_labels[level]; label++)
+
+                        // Blocks using less than half of the bins are stored sparsely, as a
+                        // sparse entry takes twice the memory of a bin. The top level is
+                        // always dense, it is updated most.
+			sparse[level] = (level < seeds_top_level && 2*(seeds_w*seeds_h << 2*level) < histogram_size);
+			entry_start[level] = NULL;
+			nr_entries[level] = NULL;
+			entry_bins[level] = NULL;
+			entry_counts[level] = NULL;
+			histogram[level] = NULL;
+
+			if (sparse[level])
+			{
+				entry_start[level] = new int[nr_labels[level] + 1];
+				nr_entries[level] = new int[nr_labels[level]];
+
+				entry_start[level][0] = 0;
+				for (int label=0; label<nr_labels[level]; label++)
+				{
+					entry_start[level][label + 1] = entry_start[level][label] + min(pixels[label], histogram_size);
+				}
+
+				entry_bins[level] = new int[entry_start[level][nr_labels[level]]];
+				entry_counts[level] = new int[entry_start[level][nr_labels[level]]];
+			}
+			else
 			{
-				histogram[level][label] = new int[histogram_size]; // histogram bins
+				histogram[level] = new int*[nr_labels[level]];
+				for (int label=0; label<nr_labels[level]; label++)
+				{
+					histogram[level][label] = new int[histogram_size]; // histogram bins
+				}
+			}
+
+			if (level < seeds_top_level)
+			{
+				vector<int> next(nr_labels[level + 1], 0);
+				for (int label=0; label<nr_labels[level]; label++) next[parent[level][label]] += pixels[label];
+				pixels.swap(next);
 			}
 		}
 	}
 
 	// Initialize empty histograms - this could also be done in the for loop before.
+	clear_histograms();
+
+	// Histograms are built in a level-wise manner, that is first the histograms
+        // for the first level are built using the pixels, then the histograms
+        // can simply be added to for the histogram of blocks at the next level.
+        // The histograms are built using the add_pxiel and add_block methods
+        // which automatically update the histograms.
+	for (int x=0; x<width; x++)
+		for (int y=0; y<height; y++)
+		{					
+			int i = y*width +x;
+			add_pixel(0, labels[0][i], x, y);
+		}
+
+	for (int level=1; level<until_level; level++)
+	{
+		for (int label=0; label<nr_labels[level-1]; label++)
+		{
+			add_block(level, parent[level-1][label], level-1, label);
+		}
+	}
+}
+
+/**
+ * Compute the histograms explicitely, that is without using add_pixel or
+ * add_block as in compute_histograms.
+ */
+void SEEDS::compute_histograms_ex()
+{
+	clear_histograms();
+
+	for (int level=0; level<seeds_nr_levels; level++)
+		for (int x=0; x<width; x++)
+			for (int y=0; y<height; y++)
+			{					
+				int i = y*width +x;
+				int label = (level == seeds_top_level) ? labels[level][i] : block_label(level, labels[0][i]);
+				add_pixel(level, label, x, y);
+			}
+
+}
+
+/**
+ * Clears the histograms and block sizes at all levels.
+ */
+void SEEDS::clear_histograms()
+{
 	for (int level=0; level<seeds_nr_levels; level++)
 		for (int label=0; label<nr_labels[level]; label++)
 		{
-			for (int j=0; j<histogram_size; j++)
-				histogram[level][label][j] = 0;
+			if (sparse[level])
+			{
+				nr_entries[level][label] = 0;
+			}
+			else
+			{
+				for (int j=0; j<histogram_size; j++)
+					histogram[level][label][j] = 0;
+			}
 			T[level][label] = 0;
 		}
+}
 
-	// Histograms are built in a level-wise manner, that is first the histograms
-        // for the first level are built using the pixels, then the histograms
-        // can simply be added to for the histogram of blocks at the next level.
-        // The histograms are built using the add_pxiel and add_block methods
-        // which automatically update the histograms.
-	for (int x=0; x<width; x++)
-		for (int y=0; y<height; y++)
-		{					
-			int i = y*width +x;
-			add_pixel(0, labels[0][i], x, y);
-		}
+/**
+ * Adds count (which may be negative) to the given bin of a sparsely stored
+ * histogram, inserting the bin if necessary. Bins with a count of zero are
+ * kept until the space is needed for a new bin.
+ * 
+ * @param level
+ * @param label
+ * @param bin
+ * @param count
+ */
+void SEEDS::add_entry(int level, int label, int bin, int count)
+{
+	int* bins = entry_bins[level] + entry_start[level][label];
+	int* counts = entry_counts[level] + entry_start[level][label];
+	int& n = nr_entries[level][label];
 
-	for (int level=1; level<until_level; level++)
+	int k = 0;
+	while (k < n && bins[k] < bin) k++;
+
+	if (k < n && bins[k] == bin)
 	{
-		for (int label=0; label<nr_labels[level-1]; label++)
+		counts[k] += count;
+		return;
+	}
+
+        // A block with a full list has less pixels than entries (as a pixel was
+        // deleted before), so there is at least one bin with a count of zero.
+	if (n == entry_start[level][label + 1] - entry_start[level][label])
+	{
+		int m = 0;
+		for (int j=0; j<n; j++)
 		{
-			add_block(level, parent[level-1][label], level-1, label);
+			if (counts[j] == 0) continue;
+			bins[m] = bins[j];
+			counts[m] = counts[j];
+			m++;
 		}
+		n = m;
+
+		k = 0;
+		while (k < n && bins[k] < bin) k++;
+	}
+
+	for (int j=n; j>k; j--)
+	{
+		bins[j] = bins[j - 1];
+		counts[j] = counts[j - 1];
 	}
+
+	bins[k] = bin;
+	counts[k] = count;
+	n++;
 }
 
 /**
- * Compute the histograms explicitely, that is without using add_pixel or
- * add_block as in compute_histograms.
+ * Adds (sign = 1) or subtracts (sign = -1) the sparsely stored histogram of
+ * the given sublabel to the sparsely stored histogram of label. Both lists are
+ * sorted, so they are merged from the back in place.
+ * 
+ * @param level
+ * @param label
+ * @param sublevel
+ * @param sublabel
+ * @param sign
  */
-void SEEDS::compute_histograms_ex()
+void SEEDS::merge_entries(int level, int label, int sublevel, int sublabel, int sign)
 {
-	// clear histograms
-	for (int level=0; level<seeds_nr_levels; level++)
-		for (int label=0; label<nr_labels[level]; label++)
+	int* bins = entry_bins[level] + entry_start[level][label];
+	int* counts = entry_counts[level] + entry_start[level][label];
+	int n = nr_entries[level][label];
+
+	const int* subbins = entry_bins[sublevel] + entry_start[sublevel][sublabel];
+	const int* subcounts = entry_counts[sublevel] + entry_start[sublevel][sublabel];
+	int m = nr_entries[sublevel][sublabel];
+
+	// Count the bins of the sublabel which are new to the label.
+	int added = 0;
+	for (int i=0, j=0; j<m; j++)
+	{
+		while (i < n && bins[i] < subbins[j]) i++;
+		if (i == n || bins[i] != subbins[j]) added++;
+	}
+
+	int i = n - 1;
+	int k = n + added - 1;
+	for (int j=m-1; j>=0; k--)
+	{
+		if (i >= 0 && bins[i] > subbins[j])
 		{
-			for (int j=0; j<histogram_size; j++)
-				histogram[level][label][j] = 0;
-			T[level][label] = 0;
+			bins[k] = bins[i];
+			counts[k] = counts[i];
+			i--;
 		}
+		else if (i >= 0 && bins[i] == subbins[j])
+		{
+			bins[k] = bins[i];
+			counts[k] = counts[i] + sign*subcounts[j];
+			i--;
+			j--;
+		}
+		else
+		{
+			bins[k] = subbins[j];
+			counts[k] = sign*subcounts[j];
+			j--;
+		}
+	}
 
-	for (int level=0; level<seeds_nr_levels; level++)
-		for (int x=0; x<width; x++)
-			for (int y=0; y<height; y++)
-			{					
-				int i = y*width +x;
-				//add_pixel(level, labels[level][i], x, y);
-				histogram[level][labels[level][i]][image_bins[y*width+x]]++;
-				T[level][labels[level][i]]++;
-			}
-
+	nr_entries[level][label] = n + added;
 }
 
 void SEEDS::compute_edges()
@@ -643,11 +1319,15 @@ void SEEDS::compute_edges()
  * The only exception to the greedy exchanging of blocks is req_confidence. A block is
  * not moved to a superpixel with intersection confidence not greater than req_confidence.
  * 
+ * Returns the number of blocks moved to a different superpixel.
+ * 
  * @param level
  * @param req_confidence
+ * @return 
  */
-void SEEDS::update_blocks(int level, float req_confidence)
+int SEEDS::update_blocks(int level, float req_confidence)
 {
+	int moves = 0;
 	int labelA;
 	int labelB;
 	int sublabel;
@@ -666,6 +1346,9 @@ void SEEDS::update_blocks(int level, float req_confidence)
 	for (int y=0; y<nr_h[level]; y++)
 		for (int x=0; x<nr_w[level]-1; x++) 
 		{
+			// for video, only blocks in changed regions are considered
+			if (masked && (!block_mask[y*step+x] || !block_mask[y*step+x+1])) continue;
+
 			// choose a label at the current level
 			sublabel = y*step+x; 
 			// get the label at the top level (= superpixel label)
@@ -676,18 +1359,13 @@ void SEEDS::update_blocks(int level, float req_confidence)
 			if (labelA != labelB)
 			{
 				// get the surrounding labels at the top level, to check for splitting 
-				int a11 = parent[level][(y-1)*step+(x-1)]; 
-				int a12 = parent[level][(y-1)*step+(x)];
-				int a13 = parent[level][(y-1)*step+(x+1)];
-				int a14 = parent[level][(y-1)*step+(x+2)];
-				int a21 = parent[level][(y)*step+(x-1)];
-				int a22 = parent[level][(y)*step+(x)];
-				int a23 = parent[level][(y)*step+(x+1)];
-				int a24 = parent[level][(y)*step+(x+2)];
-				int a31 = parent[level][(y+1)*step+(x-1)];
-				int a32 = parent[level][(y+1)*step+(x)];
-				int a33 = parent[level][(y+1)*step+(x+1)];
-				int a34 = parent[level][(y+1)*step+(x+2)];
+				UINT window[16];
+				for (int r=0; r<3; r++)
+					for (int c=0; c<4; c++)
+						window[4*r + c] = block_parent(level, (y-1+r)*step+(x-1+c));
+
+				int maskA, maskB;
+				window_masks(window, 4, true, labelA, labelB, maskA, maskB);
 
 				done = false;
 
@@ -709,6 +1387,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						if ((intB > intA) && (confidence > req_confidence))
 						{
 							add_block(seeds_top_level, labelB, level, sublabel);
+							moves++;
 							done = true;
 						}
 						else
@@ -721,7 +1400,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 					{
                                                 // Check whether exchanging the chosen sublabel would split a superpixel,
                                                 // then the resulting segmentation would be invalid.
-						if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
+						if (!(topology_h[maskA] & SPLIT_FIRST))
 						{
 							// As with only 2 partitions, delete block from label A
                                                         // and check the intersection with label A and B.
@@ -734,6 +1413,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 							if ((intB > intA) && (confidence > req_confidence))
 							{
 								add_block(seeds_top_level, labelB, level, sublabel);
+								moves++;
 								done = true;
 							}
 							else
@@ -761,6 +1441,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						if ((intA > intB) && (confidence > req_confidence))
 						{
 							add_block(seeds_top_level, labelA, level, sublabel);
+							moves++;
 							x++;
 						}
 						else
@@ -770,7 +1451,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 					}
 					else if (nr_partitions[seeds_top_level][labelB] > 2)
 					{
-						if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
+						if (!(topology_h[maskB] & SPLIT_SECOND))
 						{
 							delete_block(seeds_top_level, labelB, level, sublabel);
 							float intA = intersection(seeds_top_level, labelA, level, sublabel);
@@ -779,6 +1460,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 							if ((intA > intB) && (confidence > req_confidence))
 							{
 								add_block(seeds_top_level, labelA, level, sublabel);
+								moves++;
 								x++;
 							}
 							else
@@ -798,6 +1480,8 @@ void SEEDS::update_blocks(int level, float req_confidence)
 	for (int x=0; x<nr_w[level]; x++)
 		for (int y=0; y<nr_h[level]-1; y++)
 		{
+			if (masked && (!block_mask[y*step+x] || !block_mask[(y+1)*step+x])) continue;
+
 			// choose a label at the current level
 			sublabel = y*step+x; 
 			// get the label at the top level (= superpixel label)
@@ -807,18 +1491,14 @@ void SEEDS::update_blocks(int level, float req_confidence)
 
 			if (labelA != labelB)
 			{
-				int a11 = parent[level][(y-1)*step+(x-1)];
-				int a12 = parent[level][(y-1)*step+(x)];
-				int a13 = parent[level][(y-1)*step+(x+1)];
-				int a21 = parent[level][(y)*step+(x-1)];
-				int a22 = parent[level][(y)*step+(x)];
-				int a23 = parent[level][(y)*step+(x+1)];
-				int a31 = parent[level][(y+1)*step+(x-1)];
-				int a32 = parent[level][(y+1)*step+(x)];
-				int a33 = parent[level][(y+1)*step+(x+1)];
-				int a41 = parent[level][(y+2)*step+(x-1)];
-				int a42 = parent[level][(y+2)*step+(x)];
-				int a43 = parent[level][(y+2)*step+(x+1)];
+				// The fourth column is only read, but not used by window_masks.
+				UINT window[16] = {0};
+				for (int r=0; r<4; r++)
+					for (int c=0; c<3; c++)
+						window[4*r + c] = block_parent(level, (y-1+r)*step+(x-1+c));
+
+				int maskA, maskB;
+				window_masks(window, 4, false, labelA, labelB, maskA, maskB);
 
 				done = false;
 				if (nr_partitions[seeds_top_level][labelA] > MINIMUM_NR_SUBLABELS)
@@ -833,6 +1513,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						if ((intB > intA) && (confidence > req_confidence))
 						{
 							add_block(seeds_top_level, labelB, level, sublabel);
+							moves++;
 							//y++;
 							done = true;
 						}
@@ -843,7 +1524,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 					}
 					else if (nr_partitions[seeds_top_level][labelA] > 2) // 3 or more partitions
 					{
-						if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
+						if (!(topology_v[maskA] & SPLIT_FIRST))
 						{
 							delete_block(seeds_top_level, labelA, level, sublabel);
 							float intA = intersection(seeds_top_level, labelA, level, sublabel);
@@ -853,6 +1534,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 							if ((intB > intA) && (confidence > req_confidence))
 							{
 								add_block(seeds_top_level, labelB, level, sublabel);
+								moves++;
 								//y++;
 								done = true;
 							}
@@ -878,6 +1560,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 						if ((intA > intB) && (confidence > req_confidence))
 						{
 							add_block(seeds_top_level, labelA, level, sublabel);
+							moves++;
 							y++;
 						}
 						else
@@ -887,7 +1570,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 					}
 					else if (nr_partitions[seeds_top_level][labelB] > 2)
 					{
-						if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
+						if (!(topology_v[maskB] & SPLIT_SECOND))
 						{
 							delete_block(seeds_top_level, labelB, level, sublabel);
 							float intA = intersection(seeds_top_level, labelA, level, sublabel);
@@ -897,6 +1580,7 @@ void SEEDS::update_blocks(int level, float req_confidence)
 							if ((intA > intB) && (confidence > req_confidence))
 							{
 								add_block(seeds_top_level, labelA, level, sublabel);
+								moves++;
 								y++;
 							}
 							else
@@ -909,12 +1593,15 @@ void SEEDS::update_blocks(int level, float req_confidence)
 			}
 		}
 		update_labels(level);
+
+	return moves;
 }
 
 /**
  * After performing block updates at the current level, the level is decreased.
  * This method updates the parent and nr_partitions array accordingly as used in
- * update_blocks.
+ * update_blocks. If enabled, a snapshot of the segmentation is taken before,
+ * see set_snapshots.
  * 
  * @return 
  */
@@ -923,6 +1610,16 @@ int SEEDS::go_down_one_level()
 	int old_level = seeds_current_level;
 	int new_level = seeds_current_level - 1;
 
+	// Keep the segmentation of the level that is left.
+	if (take_snapshots && !masked)
+	{
+		snapshots[old_level].resize(nr_labels[0]);
+		for (int label=0; label<nr_labels[0]; label++)
+		{
+			snapshots[old_level][label] = parent[old_level][block_label(old_level, label)];
+		}
+	}
+
 	if (new_level < 0) return -1;
 
 	// go through labels of top level
@@ -947,209 +1644,242 @@ int SEEDS::go_down_one_level()
 	return new_level;
 }
 
+/**
+ * Performs pixel updates using the variant chosen in the constructor.
+ * 
+ * Returns the number of pixels moved to a different superpixel.
+ * 
+ * @return 
+ */
+int SEEDS::update_pixels()
+{
+	if (use_means)
+	{
+		return use_prior ? update_pixels<true, true>() : update_pixels<true, false>();
+	}
+
+	return use_prior ? update_pixels<false, true>() : update_pixels<false, false>();
+}
+
 /**
  * This method runs over all pixels and checks whether to move the pixel horizontally
  * or vertically. The decision of whether to move is done using a simple probability
  * computation which may incorporate a prior built by the local neighbourhood.
  * 
- * Update pixels based on the histograms.
+ * Update pixels based on the histograms, or based on the means if MEANS is set as
+ * described in [2] similar to SLIC. If PRIOR is set, the 3x3 smoothing prior is used.
+ * 
+ * Returns the number of pixels moved to a different superpixel.
+ * 
+ * @return 
  */
-void SEEDS::update_pixels()
+template<bool MEANS, bool PRIOR>
+int SEEDS::update_pixels()
 {
+	int moves = 0;
 	int labelA, labelA1, labelA2, labelA3;
 	int labelB, labelB1, labelB2, labelB3;
 	int priorA;
 	int priorB;
 	float edgeA;
 	float edgeB;
+	UINT* top = labels[seeds_top_level];
 
 	if (forwardbackward)
 	{
 		forwardbackward = false;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
+		// Only pixels with a different label to the right are visited, in raster order.
+		prepare_boundaries(true);
+		for (int k=0, n=h_boundaries.size(); k<n; k++)
+		{
+			int x = h_boundaries[k] % width;
+			int y = h_boundaries[k] / width;
+
+                        // For video, only pixels in changed regions are updated.
+			if (masked && !block_mask[labels[0][y*width+x]]) continue;
+
+			// Label A is the current label, label B is the
+                        // label to move the current pixel to.
+			labelA = top[y*width+x];
+			labelB = top[y*width+x+1];
+			if (labelA != labelB)
 			{
-                                // Get all labels in a three by four neighbourhood.
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// Label A is the current label, label B is the
-                                // label to move the current pixel to.
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
+				// Masks of the labels equal to A and B in the three by four neighbourhood.
+				int maskA, maskB;
+				window_masks(top + (y-1)*width + (x-1), width, true, labelA, labelB, maskA, maskB);
+
+				if (!(topology_h[maskA] & SPLIT_FIRST))
 				{
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
+                                        // Incorporate a simple prior based on the
+                                        // labels of the local neighbourhood of the pixel.
+					if (PRIOR)
 					{
-                                                // Incorporate a simple prior based on the
-                                                // labels of the local neighbourhood of the pixel.
-						#ifdef PRIOR
-						priorA = threebyfour(x,y,labelA);
-						priorB = threebyfour(x,y,labelB);
-						#endif
-
-						if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						}
-						else if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
+						priorA = topology_h[maskA] & PRIOR_COUNT;
+						priorB = topology_h[maskB] & PRIOR_COUNT;
+					}
+
+					if (probability<MEANS, PRIOR>(y*width+x, labelA, labelB, priorA, priorB, edgeA, edgeB)) 
+					{
+						update<MEANS>(seeds_top_level, labelB, x, y);
+						moves++;
+					}
+					else if (!(topology_h[maskB] & SPLIT_SECOND))
+					{
+						if (probability<MEANS, PRIOR>(y*width+x+1, labelB, labelA, priorB, priorA, edgeB, edgeA)) 
 						{
-							if (probability(image_bins[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x+1, y);
-								x++;
-							}
+							update<MEANS>(seeds_top_level, labelA, x+1, y);
+							moves++;
+							x++;
 						}
 					}
 				}
 			}
 
+			// If the next pixel has been moved (x++), it is skipped.
+			if (k+1 < n && h_boundaries[k+1] == y*width + x) k++;
+		}
+
                 // Same procedure for vertical movements of the current pixel.
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
+		// Only pixels with a different label below are visited, column by column.
+		prepare_boundaries(false);
+		for (int k=0, n=v_boundaries.size(); k<n; k++)
+		{
+			int x = v_boundaries[k] / height;
+			int y = v_boundaries[k] % height;
+
+			if (masked && !block_mask[labels[0][y*width+x]]) continue;
+
+			labelA = top[y*width+x];
+			labelB = top[(y+1)*width+x];
+			if (labelA != labelB)
 			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				labelA = a22;
-				labelB = a32;
-				if (labelA != labelB)
+				// Masks of the labels equal to A and B in the four by three neighbourhood.
+				int maskA, maskB;
+				window_masks(top + (y-1)*width + (x-1), width, false, labelA, labelB, maskA, maskB);
+
+				if (!(topology_v[maskA] & SPLIT_FIRST))
 				{
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
+					if (PRIOR)
 					{
-						#ifdef PRIOR
-						priorA = fourbythree(x,y,labelA);
-						priorB =  fourbythree(x,y,labelB);
-						#endif
+						priorA = topology_v[maskA] & PRIOR_COUNT;
+						priorB = topology_v[maskB] & PRIOR_COUNT;
+					}
 
-						if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						} 
-						else if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
+					if (probability<MEANS, PRIOR>(y*width+x, labelA, labelB, priorA, priorB, edgeA, edgeB)) 
+					{
+						update<MEANS>(seeds_top_level, labelB, x, y);
+						moves++;
+					} 
+					else if (!(topology_v[maskB] & SPLIT_SECOND))
+					{
+						if (probability<MEANS, PRIOR>((y+1)*width+x, labelB, labelA, priorB, priorA, edgeB, edgeA)) 
 						{
-							if (probability(image_bins[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x, y+1);
-								y++;
-							}
+							update<MEANS>(seeds_top_level, labelA, x, y+1);
+							moves++;
+							y++;
 						}
 					}
 				}
 			}
+
+			// If the next pixel has been moved (y++), it is skipped.
+			if (k+1 < n && v_boundaries[k+1] == x*height + y) k++;
+		}
 	}
 	else
 	{
 		forwardbackward = true;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
+		prepare_boundaries(true);
+		for (int k=0, n=h_boundaries.size(); k<n; k++)
+		{
+			int x = h_boundaries[k] % width;
+			int y = h_boundaries[k] / width;
+
+			if (masked && !block_mask[labels[0][y*width+x]]) continue;
+
+			// horizontal bidirectional
+			labelA = top[y*width+x];
+			labelB = top[y*width+x+1];
+			if (labelA != labelB)
 			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// horizontal bidirectional
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
+				// Masks of the labels equal to A and B in the three by four neighbourhood.
+				int maskA, maskB;
+				window_masks(top + (y-1)*width + (x-1), width, true, labelA, labelB, maskA, maskB);
+
+				if (!(topology_h[maskB] & SPLIT_SECOND))
 				{
-					if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
+					if (PRIOR)
 					{
-						#ifdef PRIOR
-						priorA = threebyfour(x,y,labelA);
-						priorB = threebyfour(x,y,labelB);
-						#endif
+						priorA = topology_h[maskA] & PRIOR_COUNT;
+						priorB = topology_h[maskB] & PRIOR_COUNT;
+					}
 
-						if (probability(image_bins[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-						{
-							update(seeds_top_level, labelA, x+1, y);
-							x++;
-						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
+					if (probability<MEANS, PRIOR>(y*width+x+1, labelB, labelA, priorB, priorA, edgeB, edgeA)) 
+					{
+						update<MEANS>(seeds_top_level, labelA, x+1, y);
+						moves++;
+						x++;
+					}
+					else if (!(topology_h[maskA] & SPLIT_FIRST))
+					{
+						if (probability<MEANS, PRIOR>(y*width+x, labelA, labelB, priorA, priorB, edgeA, edgeB)) 
 						{
-							if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
+							update<MEANS>(seeds_top_level, labelB, x, y);
+							moves++;
 						}
 					}
 				}
 			}
 
+			if (k+1 < n && h_boundaries[k+1] == y*width + x) k++;
+		}
 
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
+
+		prepare_boundaries(false);
+		for (int k=0, n=v_boundaries.size(); k<n; k++)
+		{
+			int x = v_boundaries[k] / height;
+			int y = v_boundaries[k] % height;
+
+			if (masked && !block_mask[labels[0][y*width+x]]) continue;
+
+			// vertical bidirectional
+			labelA = top[y*width+x];
+			labelB = top[(y+1)*width+x];
+			if (labelA != labelB)
 			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				// vertical bidirectional
-				labelA = a22;
-				labelB = a32;
-				if (labelA != labelB)
+				// Masks of the labels equal to A and B in the four by three neighbourhood.
+				int maskA, maskB;
+				window_masks(top + (y-1)*width + (x-1), width, false, labelA, labelB, maskA, maskB);
+
+				if (!(topology_v[maskB] & SPLIT_SECOND))
 				{
-					if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
+					if (PRIOR)
 					{
-						#ifdef PRIOR						
-						priorA = fourbythree(x,y,labelA);
-						priorB =  fourbythree(x,y,labelB);
-						#endif
+						priorA = topology_v[maskA] & PRIOR_COUNT;
+						priorB = topology_v[maskB] & PRIOR_COUNT;
+					}
 
-						if (probability(image_bins[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-						{
-							update(seeds_top_level, labelA, x, y+1);
-							y++;
-						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
+					if (probability<MEANS, PRIOR>((y+1)*width+x, labelB, labelA, priorB, priorA, edgeB, edgeA)) 
+					{
+						update<MEANS>(seeds_top_level, labelA, x, y+1);
+						moves++;
+						y++;
+					}
+					else if (!(topology_v[maskA] & SPLIT_FIRST))
+					{
+						if (probability<MEANS, PRIOR>(y*width+x, labelA, labelB, priorA, priorB, edgeA, edgeB)) 
 						{
-							if (probability(image_bins[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
+							update<MEANS>(seeds_top_level, labelB, x, y);
+							moves++;
 						}
 					}
 				}
 			}
 
+			if (k+1 < n && v_boundaries[k+1] == x*height + y) k++;
+		}
+
 	}
 
 	// Update the border pixels, here we do not have to check the entire
@@ -1158,292 +1888,171 @@ void SEEDS::update_pixels()
 	{
 		labelA = labels[seeds_top_level][x];
 		labelB = labels[seeds_top_level][width+x];
-		if (labelA != labelB)
+		if (labelA != labelB && (!masked || block_mask[labels[0][x]]))
 		{
-				update(seeds_top_level, labelB, x, 0);	
+				update<MEANS>(seeds_top_level, labelB, x, 0);	
+				moves++;
 		}
 		labelA = labels[seeds_top_level][(height-1)*width + x];
 		labelB = labels[seeds_top_level][(height-2)*width + x];
-		if (labelA != labelB)
+		if (labelA != labelB && (!masked || block_mask[labels[0][(height-1)*width + x]]))
 		{
-				update(seeds_top_level, labelB, x, height-1);			
+				update<MEANS>(seeds_top_level, labelB, x, height-1);			
+				moves++;
 		}
 	}
 	for (int y=0; y<height; y++)
 	{
 		labelA = labels[seeds_top_level][y*width];
 		labelB = labels[seeds_top_level][y*width+1];
-		if (labelA != labelB)
+		if (labelA != labelB && (!masked || block_mask[labels[0][y*width]]))
 		{
-				update(seeds_top_level, labelB, 0, y);	
+				update<MEANS>(seeds_top_level, labelB, 0, y);	
+				moves++;
 		}
 		labelA = labels[seeds_top_level][y*width + width - 1];
 		labelB = labels[seeds_top_level][y*width + width - 2];
-		if (labelA != labelB)
+		if (labelA != labelB && (!masked || block_mask[labels[0][y*width + width - 1]]))
 		{
-				update(seeds_top_level, labelB, width-1, y);			
+				update<MEANS>(seeds_top_level, labelB, width-1, y);			
+				moves++;
 		}
 	}
+
+	return moves;
 }
 
 /**
- * Update pixels mean-based as described in [2] similar to SLIC.
+ * Updates the label of a single pixel at the given level.
+ * 
+ * @param level
+ * @param label_new
+ * @param x
+ * @param y
  */
-void SEEDS::update_pixels_means()
+template<bool MEANS>
+void SEEDS::update(int level, int label_new, int x, int y)
 {
-	int labelA, labelA1, labelA2, labelA3;
-	int labelB, labelB1, labelB2, labelB3;
-	int priorA;
-	int priorB;
-	float edgeA;
-	float edgeB;
+	int label_old = labels[level][y*width+x];
+    delete_pixel_m<MEANS>(level, label_old, x, y);
+    add_pixel_m<MEANS>(level, label_new, x, y);
+	labels[level][y*width+x] = label_new;
 
-	if (forwardbackward)
+	if (boundaries_valid && level == seeds_top_level)
 	{
-		forwardbackward = false;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
-			{
-                                // 3 by 4 neighbourhood of current pixel.
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)];
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)]; 
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// a22 is the label of the current pixel,
-                                // a23 is the label of the neighbouring superpixel.
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
-				{
-                                        // Only exchange pixel to neighbouring superpixel if the superpixel is
-                                        // not going to be split up.
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
-					{
-                                                // Compute a simple prior whether the current pixel
-                                                // should be exchanged or not.
-						#ifdef PRIOR
-						priorA = threebyfour(x,y,labelA); // Label A is the current label of pixel (x,y).
-						priorB = threebyfour(x,y,labelB);
-						#endif
-
-                                                // Check whether it is probable that the current pixel belongs to label B.
-						if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						}
-                                                // At the same point check the next pixel given by x+1 whether to move, as well.
-						else if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
-						{
-							if (probability_means(image_l[y*width+x+1], image_a[y*width+x+1], image_b[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x+1, y);
-								x++;
-							}
-						}
-					}
-				}
-			}
+		add_boundaries(x, y);
+	}
+}
 
-                // Same procedure for vertical moving of pixels.
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
-			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				// Label A is the current label of the pixel,
-                                // label B the label to move the pixel to.
-				labelA = a22;
-				labelB = a32;
-                                
-                                // The approach is the same as with the horizontal exchanging of pixels - 
-                                // use the probability estimate to check whether to move the pixel.
-				if (labelA != labelB)
-				{
-					if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
-					{
-						#ifdef PRIOR
-						priorA = fourbythree(x,y,labelA);
-						priorB =  fourbythree(x,y,labelB);
-						#endif
+/**
+ * Called after the label of the given pixel changed: the pairs of pixels the
+ * pixel is part of may have become boundaries and are added to the boundary lists
+ * used by update_pixels. Pairs which are no boundaries anymore are removed in
+ * prepare_boundaries.
+ * 
+ * h_boundaries contains the pixels (x,y) with a different label at (x+1,y) as y*width+x,
+ * v_boundaries contains the pixels (x,y) with a different label at (x,y+1) as x*height+y.
+ * 
+ * @param x
+ * @param y
+ */
+void SEEDS::add_boundaries(int x, int y)
+{
+	UINT* top = labels[seeds_top_level];
 
-						if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-						{
-							update(seeds_top_level, labelB, x, y);
-						} 
-						else if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
-						{
-							if (probability_means(image_l[(y+1)*width+x], image_a[(y+1)*width+x], image_b[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-							{
-								update(seeds_top_level, labelA, x, y+1);
-								y++;
-							}
-						}
-					}
-				}
-			}
+	for (int dx=-1; dx<=0; dx++)
+	{
+		int i = y*width + x + dx;
+		if (x+dx >= 1 && x+dx < width-1 && y >= 1 && y < height-1 
+			&& !(boundary_flags[i] & 1) && top[i] != top[i+1])
+		{
+			boundary_flags[i] |= 1;
+			h_boundaries.push_back(i);
+		}
 	}
-	else
+
+	for (int dy=-1; dy<=0; dy++)
 	{
-		forwardbackward = true;
-		for (int y=1; y<height-1; y++)
-			for (int x=1; x<width-1; x++) 
-			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a14 = labels[seeds_top_level][(y-1)*width+(x+2)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)]; 
-				int a24 = labels[seeds_top_level][(y)*width+(x+2)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)];
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a34 = labels[seeds_top_level][(y+1)*width+(x+2)];
-
-				// horizontal bidirectional
-				labelA = a22;
-				labelB = a23;
-				if (labelA != labelB)
-				{
-					if (!check_split(a12, a13, a14, a22, a23, a24, a32, a33, a34, true, false))
-					{
-						#ifdef PRIOR
-						priorA = threebyfour(x,y,labelA);
-						priorB = threebyfour(x,y,labelB);
-						#endif
+		int i = (y+dy)*width + x;
+		if (x >= 1 && x < width-1 && y+dy >= 1 && y+dy < height-1 
+			&& !(boundary_flags[i] & 2) && top[i] != top[i+width])
+		{
+			boundary_flags[i] |= 2;
+			v_boundaries.push_back(x*height + y+dy);
+		}
+	}
+}
 
-						if (probability_means(image_l[y*width+x+1], image_a[y*width+x+1], image_b[y*width+x+1], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-						{
-							update(seeds_top_level, labelA, x+1, y);
-							x++;
-						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, true, true))
-						{
-							if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
-						}
-					}
-				}
-			}
+/**
+ * Prepares the horizontal or vertical boundary list for a pass of update_pixels:
+ * after the block updates the lists are built by scanning the image once, afterwards
+ * they are maintained by add_boundaries. Pairs which are no boundaries anymore are
+ * removed and the list is sorted in the order the full scan would visit the pixels:
+ * row by row for horizontal and column by column for vertical updates.
+ * 
+ * @param horizontal
+ */
+void SEEDS::prepare_boundaries(bool horizontal)
+{
+	UINT* top = labels[seeds_top_level];
 
+	if (!boundaries_valid)
+	{
+		boundary_flags.assign(width*height, 0);
+		h_boundaries.clear();
+		v_boundaries.clear();
 
-		for (int x=1; x<width-1; x++)
-			for (int y=1; y<height-1; y++)
-			{
-				int a11 = labels[seeds_top_level][(y-1)*width+(x-1)];
-				int a12 = labels[seeds_top_level][(y-1)*width+(x)];
-				int a13 = labels[seeds_top_level][(y-1)*width+(x+1)];
-				int a21 = labels[seeds_top_level][(y)*width+(x-1)];
-				int a22 = labels[seeds_top_level][(y)*width+(x)]; 
-				int a23 = labels[seeds_top_level][(y)*width+(x+1)];
-				int a31 = labels[seeds_top_level][(y+1)*width+(x-1)];
-				int a32 = labels[seeds_top_level][(y+1)*width+(x)]; 
-				int a33 = labels[seeds_top_level][(y+1)*width+(x+1)];
-				int a41 = labels[seeds_top_level][(y+2)*width+(x-1)];
-				int a42 = labels[seeds_top_level][(y+2)*width+(x)];
-				int a43 = labels[seeds_top_level][(y+2)*width+(x+1)];
-
-				// vertical bidirectional
-				labelA = a22;
-				labelB = a32;
-				if (labelA != labelB)
+		for (int y=1; y<height-1; y++)
+			for (int x=1; x<width-1; x++)
+				if (top[y*width+x] != top[y*width+x+1])
 				{
-					if (!check_split(a21, a22, a23, a31, a32, a33, a41, a42, a43, false, false))
-					{
-						#ifdef PRIOR
-						priorA = fourbythree(x,y,labelA);
-						priorB =  fourbythree(x,y,labelB);
-						#endif
+					boundary_flags[y*width+x] |= 1;
+					h_boundaries.push_back(y*width + x);
+				}
 
-						if (probability_means(image_l[(y+1)*width+x], image_a[(y+1)*width+x], image_b[(y+1)*width+x], labelB, labelA, priorB, priorA, edgeB, edgeA)) 
-						{
-							update(seeds_top_level, labelA, x, y+1);
-							y++;
-						}
-						else if (!check_split(a11, a12, a13, a21, a22, a23, a31, a32, a33, false, true))
-						{
-							if (probability_means(image_l[y*width+x], image_a[y*width+x], image_b[y*width+x], labelA, labelB, priorA, priorB, edgeA, edgeB)) 
-							{
-								update(seeds_top_level, labelB, x, y);
-							}
-						}
-					}
+		for (int x=1; x<width-1; x++)
+			for (int y=1; y<height-1; y++)
+				if (top[y*width+x] != top[(y+1)*width+x])
+				{
+					boundary_flags[y*width+x] |= 2;
+					v_boundaries.push_back(x*height + y);
 				}
-			}
 
+		h_sorted = h_boundaries.size();
+		v_sorted = v_boundaries.size();
+		boundaries_valid = true;
+		return;
 	}
 
-	// For border pixels we have not to check the entire neighbourhood,
-        // simply check above and below or left and right.
-	for (int x=0; x<width; x++)
-	{
-		labelA = labels[seeds_top_level][x];
-		labelB = labels[seeds_top_level][width+x];
-		if (labelA != labelB)
-		{
-				update(seeds_top_level, labelB, x, 0);	
-		}
-		labelA = labels[seeds_top_level][(height-1)*width + x];
-		labelB = labels[seeds_top_level][(height-2)*width + x];
-		if (labelA != labelB)
-		{
-				update(seeds_top_level, labelB, x, height-1);			
-		}
-	}
-	for (int y=0; y<height; y++)
+	vector<int>& list = horizontal ? h_boundaries : v_boundaries;
+	int& sorted = horizontal ? h_sorted : v_sorted;
+	UINT flag = horizontal ? 1 : 2;
+
+	// Remove pairs which are no boundaries anymore, this keeps the order. The
+        // first m remaining entries are the sorted ones of the last pass.
+	int n = 0;
+	int m = 0;
+	for (int k=0; k<(int) list.size(); k++)
 	{
-		labelA = labels[seeds_top_level][y*width];
-		labelB = labels[seeds_top_level][y*width+1];
-		if (labelA != labelB)
+		int i = horizontal ? list[k] : (list[k] % height)*width + list[k]/height;
+		int j = horizontal ? i + 1 : i + width;
+
+		if (top[i] != top[j])
 		{
-				update(seeds_top_level, labelB, 0, y);	
+			list[n++] = list[k];
+			if (k < sorted) m = n;
 		}
-		labelA = labels[seeds_top_level][y*width + width - 1];
-		labelB = labels[seeds_top_level][y*width + width - 2];
-		if (labelA != labelB)
+		else
 		{
-				update(seeds_top_level, labelB, width-1, y);			
+			boundary_flags[i] &= ~flag;
 		}
 	}
-}
+	list.resize(n);
 
-/**
- * Updates the label of a single pixel at the given level.
- * 
- * @param level
- * @param label_new
- * @param x
- * @param y
- */
-void SEEDS::update(int level, int label_new, int x, int y)
-{
-	int label_old = labels[level][y*width+x];
-    delete_pixel_m(level, label_old, x, y);
-    add_pixel_m(level, label_new, x, y);
-	labels[level][y*width+x] = label_new;
+	// The pairs added since the last pass are merged into the sorted list.
+	sort(list.begin() + m, list.end());
+	inplace_merge(list.begin(), list.begin() + m, list.end());
+	sorted = n;
 }
 
 /**
@@ -1457,7 +2066,14 @@ void SEEDS::update(int level, int label_new, int x, int y)
  */
 void SEEDS::add_pixel(int level, int label, int x, int y)
 {
-	histogram[level][label][image_bins[y*width+x]]++;
+	if (sparse[level])
+	{
+		add_entry(level, label, image_bins[y*width+x], 1);
+	}
+	else
+	{
+		histogram[level][label][image_bins[y*width+x]]++;
+	}
 	T[level][label]++;
 }
 
@@ -1470,16 +2086,18 @@ void SEEDS::add_pixel(int level, int label, int x, int y)
  * @param x
  * @param y
  */
+template<bool MEANS>
 void SEEDS::add_pixel_m(int level, int label, int x, int y)
 {
 	histogram[level][label][image_bins[y*width+x]]++;
 	T[level][label]++;
 
-	#ifdef MEANS
+	if (MEANS)
+	{
 		L_channel[label] += image_l[y*width + x];
 		A_channel[label] += image_a[y*width + x];
 		B_channel[label] += image_b[y*width + x];
-    #endif
+	}
 }
 
 /**
@@ -1493,7 +2111,14 @@ void SEEDS::add_pixel_m(int level, int label, int x, int y)
  */
 void SEEDS::delete_pixel(int level, int label, int x, int y)
 {
-	histogram[level][label][image_bins[y*width+x]]--;
+	if (sparse[level])
+	{
+		add_entry(level, label, image_bins[y*width+x], -1);
+	}
+	else
+	{
+		histogram[level][label][image_bins[y*width+x]]--;
+	}
 	T[level][label]--;
 }
 
@@ -1504,16 +2129,18 @@ void SEEDS::delete_pixel(int level, int label, int x, int y)
  * @param x
  * @param y
  */
+template<bool MEANS>
 void SEEDS::delete_pixel_m(int level, int label, int x, int y)
 {
 	histogram[level][label][image_bins[y*width+x]]--;
 	T[level][label]--;
 	
-	#ifdef MEANS
+	if (MEANS)
+	{
 		L_channel[label] -= image_l[y*width + x];
 		A_channel[label] -= image_a[y*width + x];
 		B_channel[label] -= image_b[y*width + x];
-    #endif
+	}
 }
 
 /**
@@ -1529,9 +2156,26 @@ void SEEDS::add_block(int level, int label, int sublevel, int sublabel)
 {
 	parent[sublevel][sublabel] = label;
 
-	for (int n=0; n<histogram_size; n++)
+	// If the level is stored sparsely, so is the sublevel.
+	if (sparse[level])
+	{
+		merge_entries(level, label, sublevel, sublabel, 1);
+	}
+	else if (sparse[sublevel])
+	{
+		const int* bins = entry_bins[sublevel] + entry_start[sublevel][sublabel];
+		const int* counts = entry_counts[sublevel] + entry_start[sublevel][sublabel];
+		for (int k=0; k<nr_entries[sublevel][sublabel]; k++)
+		{
+			histogram[level][label][bins[k]] += counts[k];
+		}
+	}
+	else
 	{
-		histogram[level][label][n] += histogram[sublevel][sublabel][n];
+		for (int n=0; n<histogram_size; n++)
+		{
+			histogram[level][label][n] += histogram[sublevel][sublabel][n];
+		}
 	}
 	T[level][label] += T[sublevel][sublabel];
 
@@ -1551,9 +2195,25 @@ void SEEDS::delete_block(int level, int label, int sublevel, int sublabel)
 {
 	parent[sublevel][sublabel] = -1;
 
-	for (int n=0; n<histogram_size; n++)
+	if (sparse[level])
+	{
+		merge_entries(level, label, sublevel, sublabel, -1);
+	}
+	else if (sparse[sublevel])
+	{
+		const int* bins = entry_bins[sublevel] + entry_start[sublevel][sublabel];
+		const int* counts = entry_counts[sublevel] + entry_start[sublevel][sublabel];
+		for (int k=0; k<nr_entries[sublevel][sublabel]; k++)
+		{
+			histogram[level][label][bins[k]] -= counts[k];
+		}
+	}
+	else
 	{
-		histogram[level][label][n] -= histogram[sublevel][sublabel][n];
+		for (int n=0; n<histogram_size; n++)
+		{
+			histogram[level][label][n] -= histogram[sublevel][sublabel][n];
+		}
 	}
 	T[level][label] -= T[sublevel][sublabel];
 
@@ -1568,19 +2228,34 @@ void SEEDS::delete_block(int level, int label, int sublevel, int sublabel)
  */
 void SEEDS::update_labels(int level)
 {
+	// Look up the superpixel of each block at level 0 first.
+	block_labels.resize(nr_labels[0]);
+	for (int label=0; label<nr_labels[0]; label++)
+	{
+		block_labels[label] = parent[level][block_label(level, label)];
+	}
+
 	for (int i=0; i<width*height; i++)
 	{
-		labels[seeds_top_level][i] = parent[level][labels[level][i]];
+		// for video, pixels outside of changed regions keep their labels
+		if (masked && !block_mask[labels[0][i]]) continue;
+
+		labels[seeds_top_level][i] = block_labels[labels[0][i]];
 	}
+
+	boundaries_valid = false;
 }
 
 /**
  * Computes a probability of whether the pixel with label1 should be moved to label
  * label2 given the prior which is computed using the immediate neighbourhood of the pixel.
  * 
+ * If MEANS is set, the decision is based on the mean colors rather than the
+ * histograms, see update_pixels. The prior is only used if PRIOR is set.
+ * 
  * Returns a boolean indicating whether to move or not to move.
  * 
- * @param color
+ * @param index
  * @param label1
  * @param label2
  * @param prior1
@@ -1589,42 +2264,15 @@ void SEEDS::update_labels(int level)
  * @param edge2
  * @return 
  */
-bool SEEDS::probability(int color, int label1, int label2, int prior1, int prior2, float edge1, float edge2)
+template<bool MEANS, bool PRIOR>
+bool SEEDS::probability(int index, int label1, int label2, int prior1, int prior2, float edge1, float edge2)
 {
-        // T saves the number of pixels for each block/superpixel at each level and 
-        // can therefore be used for normalization.
-	float P_label1 = (float)histogram[seeds_top_level][label1][color] / (float)T[seeds_top_level][label1];
-	float P_label2 = (float)histogram[seeds_top_level][label2][color] / (float)T[seeds_top_level][label2];
-
-	#ifdef PRIOR
-		P_label1 *= (float) prior1;
-		P_label2 *= (float) prior2;
-	#else
-		P_label1 = (float)histogram[seeds_top_level][label1][color] / (float)T[seeds_top_level][label1];
-		P_label2 = (float)histogram[seeds_top_level][label2][color] / (float)T[seeds_top_level][label2];
-	#endif
-
-	return (P_label2 > P_label1);
-}
+	if (MEANS)
+	{
+		float L = image_l[index];
+		float a = image_a[index];
+		float b = image_b[index];
 
-/**
- * In update_pixels_mean, the decision wether to exchange a pixel is based on means
- * rather than histograms.
- * 
- * @param L
- * @param a
- * @param b
- * @param label1
- * @param label2
- * @param prior1
- * @param prior2
- * @param edge1
- * @param edge2
- * @return 
- */
-bool SEEDS::probability_means(float L, float a, float b, int label1, int label2, int prior1, int prior2, float edge1, float edge2)
-{
-	#ifdef MEANS
 		float L1 = L_channel[label1] / T[seeds_top_level][label1];
 		float a1 = A_channel[label1] / T[seeds_top_level][label1];
 		float b1 = B_channel[label1] / T[seeds_top_level][label1];
@@ -1635,15 +2283,29 @@ bool SEEDS::probability_means(float L, float a, float b, int label1, int label2,
 		float P_label1 = (L-L1)*(L-L1) + (a-a1)*(a-a1) + (b-b1)*(b-b1);
 		float P_label2 = (L-L2)*(L-L2) + (a-a2)*(a-a2) + (b-b2)*(b-b2);
 
-		#ifdef PRIOR
+		if (PRIOR)
+		{
 			P_label1 /= prior1;
 			P_label2 /= prior2;
-		#endif
+		}
 
 		return (P_label1 > P_label2);
-	#endif
+	}
 
-	return false;
+	int color = image_bins[index];
+
+        // T saves the number of pixels for each block/superpixel at each level and 
+        // can therefore be used for normalization.
+	float P_label1 = (float)histogram[seeds_top_level][label1][color] / (float)T[seeds_top_level][label1];
+	float P_label2 = (float)histogram[seeds_top_level][label2][color] / (float)T[seeds_top_level][label2];
+
+	if (PRIOR)
+	{
+		P_label1 *= (float) prior1;
+		P_label2 *= (float) prior2;
+	}
+
+	return (P_label2 > P_label1);
 }
 
 void SEEDS::LAB2RGB(float L, float a, float b, int* R, int* G, int* B)
@@ -1764,7 +2426,8 @@ int SEEDS::RGB2HSV(const int& r, const int& g, const int& b, float* hval, float*
 	if ((H<0.0) || (H>= 1.0)) printf("H: %f \n", H);
 
 	int hbin = floor(H * nr_bins);
-	int sbin = floor(S * nr_bins);
+	// S reaches 1 as soon as one channel is zero, keep it in the last bin.
+	int sbin = min((int) floor(S * nr_bins), nr_bins - 1);
 	int vbin = floor(V * nr_bins);
 
 	//printf("%d %d %d -- %f %f %f -- bins %d %d %d\n", r, g, b, H, S, V, hbin, sbin, vbin);
@@ -1898,6 +2561,191 @@ int SEEDS::RGB2LAB_special(int r, int g, int b, int* bin_l, int* bin_a, int* bin
 	return bin1 + nr_bins*bin2 + nr_bins*nr_bins*bin3;
 }
 
+#ifdef __SSE2__
+/**
+ * Cube root of four floats, used in RGB2LAB_row. The initial guess is obtained
+ * by manipulating the exponent bits, three Newton steps give full float precision.
+ * 
+ * @param x
+ * @return 
+ */
+static inline __m128 cbrt_ps(__m128 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+	bits = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(1.0f/3.0f)));
+	__m128 y = _mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(709921077)));
+
+	const __m128 third = _mm_set1_ps(1.0f/3.0f);
+	for (int k=0; k<3; k++)
+	{
+		// y = (2y + x/y^2)/3
+		y = _mm_mul_ps(third, _mm_add_ps(_mm_add_ps(y, y), _mm_div_ps(x, _mm_mul_ps(y, y))));
+	}
+
+	return y;
+}
+
+/**
+ * Select a where mask is set and b otherwise.
+ * 
+ * @param mask
+ * @param a
+ * @param b
+ * @return 
+ */
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+/**
+ * Converts a row of 8-bit pixels to (unnormalized) LAB values. Gray images
+ * (one channel) as well as BGR and BGRA images are supported, the row is read
+ * in place. Four pixels are converted at once using SSE2 if available.
+ * 
+ * @param row
+ * @param channels
+ * @param lval
+ * @param aval
+ * @param bval
+ */
+void SEEDS::RGB2LAB_row(const unsigned char* row, int channels, float* lval, float* aval, float* bval)
+{
+	int x = 0;
+
+	#ifdef __SSE2__
+		// RGB to XYZ including the normalization by the white point.
+		const __m128 m11 = _mm_set1_ps(0.412453/(255.0*0.950456));
+		const __m128 m12 = _mm_set1_ps(0.357580/(255.0*0.950456));
+		const __m128 m13 = _mm_set1_ps(0.180423/(255.0*0.950456));
+		const __m128 m21 = _mm_set1_ps(0.212671/255.0);
+		const __m128 m22 = _mm_set1_ps(0.715160/255.0);
+		const __m128 m23 = _mm_set1_ps(0.072169/255.0);
+		const __m128 m31 = _mm_set1_ps(0.019334/(255.0*1.088754));
+		const __m128 m32 = _mm_set1_ps(0.119193/(255.0*1.088754));
+		const __m128 m33 = _mm_set1_ps(0.950227/(255.0*1.088754));
+
+		const __m128 T = _mm_set1_ps(0.008856);
+		const __m128 slope = _mm_set1_ps(7.787);
+		const __m128 offset = _mm_set1_ps(16.0/116.0);
+
+		for (; x + 4 <= width; x += 4)
+		{
+			const unsigned char* p = row + x*channels;
+			__m128 r, g, b;
+			if (channels >= 3)
+			{
+				b = _mm_set_ps(p[3*channels], p[2*channels], p[channels], p[0]);
+				g = _mm_set_ps(p[3*channels + 1], p[2*channels + 1], p[channels + 1], p[1]);
+				r = _mm_set_ps(p[3*channels + 2], p[2*channels + 2], p[channels + 2], p[2]);
+			}
+			else
+			{
+				b = _mm_set_ps(p[3], p[2], p[1], p[0]);
+				g = b;
+				r = b;
+			}
+
+			__m128 xVal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m11, r), _mm_mul_ps(m12, g)), _mm_mul_ps(m13, b));
+			__m128 yVal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m21, r), _mm_mul_ps(m22, g)), _mm_mul_ps(m23, b));
+			__m128 zVal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m31, r), _mm_mul_ps(m32, g)), _mm_mul_ps(m33, b));
+
+			__m128 XT = _mm_cmpgt_ps(xVal, T);
+			__m128 YT = _mm_cmpgt_ps(yVal, T);
+			__m128 ZT = _mm_cmpgt_ps(zVal, T);
+
+			__m128 Y3 = cbrt_ps(yVal);
+			__m128 fX = select_ps(XT, cbrt_ps(xVal), _mm_add_ps(_mm_mul_ps(slope, xVal), offset));
+			__m128 fY = select_ps(YT, Y3, _mm_add_ps(_mm_mul_ps(slope, yVal), offset));
+			__m128 fZ = select_ps(ZT, cbrt_ps(zVal), _mm_add_ps(_mm_mul_ps(slope, zVal), offset));
+
+			__m128 L = select_ps(YT, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(116.0), Y3), _mm_set1_ps(16.0)),
+				_mm_mul_ps(_mm_set1_ps(903.3), yVal));
+
+			_mm_storeu_ps(lval + x, L);
+			_mm_storeu_ps(aval + x, _mm_mul_ps(_mm_set1_ps(500.0), _mm_sub_ps(fX, fY)));
+			_mm_storeu_ps(bval + x, _mm_mul_ps(_mm_set1_ps(200.0), _mm_sub_ps(fY, fZ)));
+		}
+	#endif
+
+	for (; x < width; x++)
+	{
+		const unsigned char* p = row + x*channels;
+		int b = p[0];
+		int g = (channels >= 3) ? p[1] : b;
+		int r = (channels >= 3) ? p[2] : b;
+		RGB2LAB(r, g, b, lval + x, aval + x, bval + x);
+	}
+}
+
+/**
+ * Assigns the histogram bins for a row of unnormalized LAB values and normalizes
+ * the values in place afterwards (as in initialize(UINT*, ...)). As the cutoff
+ * values are sorted, the bin of a value is the number of cutoffs below the value.
+ * 
+ * @param lval
+ * @param aval
+ * @param bval
+ * @param bins
+ */
+void SEEDS::LAB2bin_row(float* lval, float* aval, float* bval, UINT* bins)
+{
+	int x = 0;
+
+	#ifdef __SSE2__
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128 L = _mm_loadu_ps(lval + x);
+			__m128 A = _mm_loadu_ps(aval + x);
+			__m128 B = _mm_loadu_ps(bval + x);
+
+			// Comparisons yield -1 for each cutoff below the value.
+			__m128i bin1 = _mm_setzero_si128();
+			__m128i bin2 = _mm_setzero_si128();
+			__m128i bin3 = _mm_setzero_si128();
+			for (int k=0; k<nr_bins-1; k++)
+			{
+				bin1 = _mm_sub_epi32(bin1, _mm_castps_si128(_mm_cmpgt_ps(L, _mm_set1_ps(bin_cutoff1[k]))));
+				bin2 = _mm_sub_epi32(bin2, _mm_castps_si128(_mm_cmpgt_ps(A, _mm_set1_ps(bin_cutoff2[k]))));
+				bin3 = _mm_sub_epi32(bin3, _mm_castps_si128(_mm_cmpgt_ps(B, _mm_set1_ps(bin_cutoff3[k]))));
+			}
+
+			// bin1 + nr_bins*bin2 + nr_bins*nr_bins*bin3, the products are small
+			// enough to be computed in floating point.
+			__m128 bin = _mm_add_ps(_mm_cvtepi32_ps(bin1), _mm_mul_ps(_mm_set1_ps(nr_bins), 
+				_mm_add_ps(_mm_cvtepi32_ps(bin2), _mm_mul_ps(_mm_set1_ps(nr_bins), _mm_cvtepi32_ps(bin3)))));
+			_mm_storeu_si128((__m128i*) (bins + x), _mm_cvtps_epi32(bin));
+
+			_mm_storeu_ps(lval + x, _mm_div_ps(L, _mm_set1_ps(100.0)));
+			_mm_storeu_ps(aval + x, _mm_div_ps(_mm_add_ps(A, _mm_set1_ps(128.0)), _mm_set1_ps(255.0)));
+			_mm_storeu_ps(bval + x, _mm_div_ps(_mm_add_ps(B, _mm_set1_ps(128.0)), _mm_set1_ps(255.0)));
+		}
+	#endif
+
+	for (; x < width; x++)
+	{
+		int bin1 = 0;
+		int bin2 = 0;
+		int bin3 = 0;
+
+		while (lval[x] > bin_cutoff1[bin1]) {
+			bin1++;
+		}
+		while (aval[x] > bin_cutoff2[bin2]) {
+			bin2++;
+		}
+		while (bval[x] > bin_cutoff3[bin3]) {
+			bin3++;
+		}
+
+		bins[x] = bin1 + nr_bins*bin2 + nr_bins*nr_bins*bin3;
+		lval[x] = lval[x]/100.0;
+		aval[x] = (aval[x]+128.0)/255.0;
+		bval[x] = (bval[x]+128.0)/255.0;
+	}
+}
+
 /**
  * Count the number of pixels with the same label in a three bz three
  * neighbourhood around the given pixel.
@@ -1928,58 +2776,88 @@ int SEEDS::threebythree(int x, int y, int label)
 }
 
 /**
- * Count the number of same labels as the given pixel in a three by four neighbourhood.
+ * Build the topology lookup tables used for check_split and the prior.
  * 
- * @param x
- * @param y
- * @param label
- * @return 
+ * A three by four (horizontal) or four by three (vertical) window around
+ * the pixels or blocks A and B is encoded as the mask of labels equal to
+ * a given label, bit 4*r + c (horizontal) or 3*r + c (vertical) for row r and
+ * column c. For each mask, the table stores the number of equal labels
+ * without A and B (the prior, PRIOR_COUNT) and whether moving A (SPLIT_FIRST)
+ * or B (SPLIT_SECOND) would split its superpixel when the mask is taken
+ * with respect to the label of A or B, respectively.
  */
-int SEEDS::threebyfour(int x, int y, int label)
+void SEEDS::build_topology()
 {
-	int count = 0;
-	if (labels[seeds_top_level][(y-1)*width+x-1]==label) count++;
-	if (labels[seeds_top_level][(y-1)*width+x]==label) count++;
-	if (labels[seeds_top_level][(y-1)*width+x+1]==label) count++;
-	if (labels[seeds_top_level][(y-1)*width+x+2]==label) count++;
+	for (int mask=0; mask<4096; mask++)
+	{
+		int h[3][4];
+		int v[4][3];
+		int count_h = 0;
+		int count_v = 0;
+		for (int i=0; i<12; i++)
+		{
+			int bit = (mask >> i) & 1;
+			h[i/4][i%4] = bit;
+			v[i/3][i%3] = bit;
 
-	if (labels[seeds_top_level][y*width+x-1]==label) count++;
-	if (labels[seeds_top_level][y*width+x+2]==label) count++;
+			// A and B are at (1,1) and (1,2) horizontally, at (1,1) and (2,1) vertically.
+			if (i != 5 && i != 6) count_h += bit;
+			if (i != 4 && i != 7) count_v += bit;
+		}
 
-	if (labels[seeds_top_level][(y+1)*width+x-1]==label) count++;
-	if (labels[seeds_top_level][(y+1)*width+x]==label) count++;
-	if (labels[seeds_top_level][(y+1)*width+x+1]==label) count++;
-	if (labels[seeds_top_level][(y+1)*width+x+2]==label) count++;
+		topology_h[mask] = count_h;
+		if (check_split(h[0][0], h[0][1], h[0][2], h[1][0], h[1][1], h[1][2], h[2][0], h[2][1], h[2][2], true, true)) topology_h[mask] |= SPLIT_FIRST;
+		if (check_split(h[0][1], h[0][2], h[0][3], h[1][1], h[1][2], h[1][3], h[2][1], h[2][2], h[2][3], true, false)) topology_h[mask] |= SPLIT_SECOND;
 
-	return count;
+		topology_v[mask] = count_v;
+		if (check_split(v[0][0], v[0][1], v[0][2], v[1][0], v[1][1], v[1][2], v[2][0], v[2][1], v[2][2], false, true)) topology_v[mask] |= SPLIT_FIRST;
+		if (check_split(v[1][0], v[1][1], v[1][2], v[2][0], v[2][1], v[2][2], v[3][0], v[3][1], v[3][2], false, false)) topology_v[mask] |= SPLIT_SECOND;
+	}
 }
 
 /**
- * Count the number of same labels as the given pixel in a four by three neighbourhood.
+ * Compute the masks of labels equal to label A and label B in the three by four
+ * (horizontal) or four by three (vertical) window starting at the given position,
+ * see build_topology. Each row is compared at once using SSE2 if available.
  * 
- * @param x
- * @param y
- * @param label
- * @return 
+ * The vertical window is read four labels wide, so one label to the right
+ * of the window has to be readable.
+ * 
+ * @param window
+ * @param stride
+ * @param horizontal
+ * @param labelA
+ * @param labelB
+ * @param maskA
+ * @param maskB
  */
-int SEEDS::fourbythree(int x, int y, int label)
+void SEEDS::window_masks(const UINT* window, int stride, bool horizontal, int labelA, int labelB, int& maskA, int& maskB)
 {
-	int count = 0;
-	if (labels[seeds_top_level][(y-1)*width+x-1]==label) count++;
-	if (labels[seeds_top_level][(y-1)*width+x]==label) count++;
-	if (labels[seeds_top_level][(y-1)*width+x+1]==label) count++;
-
-	if (labels[seeds_top_level][y*width+x-1]==label) count++;
-	if (labels[seeds_top_level][y*width+x+2]==label) count++;
+	int rows = horizontal ? 3 : 4;
+	int cols = horizontal ? 4 : 3;
 
-	if (labels[seeds_top_level][(y+1)*width+x-1]==label) count++;
-	if (labels[seeds_top_level][(y+1)*width+x+2]==label) count++;
+	maskA = 0;
+	maskB = 0;
 
-	if (labels[seeds_top_level][(y+2)*width+x-1]==label) count++;
-	if (labels[seeds_top_level][(y+2)*width+x]==label) count++;
-	if (labels[seeds_top_level][(y+2)*width+x+1]==label) count++;
+	#ifdef __SSE2__
+		__m128i a = _mm_set1_epi32(labelA);
+		__m128i b = _mm_set1_epi32(labelB);
+		int keep = (1 << cols) - 1;
 
-	return count;
+		for (int r=0; r<rows; r++)
+		{
+			__m128i row = _mm_loadu_si128((const __m128i*) (window + r*stride));
+			maskA |= (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(row, a))) & keep) << (r*cols);
+			maskB |= (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(row, b))) & keep) << (r*cols);
+		}
+	#else
+		for (int r=0; r<rows; r++)
+			for (int c=0; c<cols; c++)
+			{
+				if (window[r*stride+c] == (UINT) labelA) maskA |= 1 << (r*cols + c);
+				if (window[r*stride+c] == (UINT) labelB) maskB |= 1 << (r*cols + c);
+			}
+	#endif
 }
 
 float SEEDS::geometric_distance(int label1, int label2)
@@ -2002,10 +2880,50 @@ float SEEDS::geometric_distance(int label1, int label2)
 float SEEDS::intersection(int level1, int label1, int level2, int label2)
 {
     float intersect = 0.0;
-	
-	for (int n=0; n<histogram_size; n++)
+
+	// Bins missing in a sparsely stored histogram do not contribute, the remaining
+	// bins are summed in the same order as for dense histograms.
+	if (sparse[level1] && sparse[level2])
+	{
+		const int* bins1 = entry_bins[level1] + entry_start[level1][label1];
+		const int* counts1 = entry_counts[level1] + entry_start[level1][label1];
+		const int* bins2 = entry_bins[level2] + entry_start[level2][label2];
+		const int* counts2 = entry_counts[level2] + entry_start[level2][label2];
+
+		for (int i=0, j=0; i<nr_entries[level1][label1] && j<nr_entries[level2][label2]; )
+		{
+			if (bins1[i] < bins2[j]) i++;
+			else if (bins1[i] > bins2[j]) j++;
+			else
+			{
+				intersect += min((float)counts1[i]/T[level1][label1], (float)counts2[j]/T[level2][label2]);
+				i++;
+				j++;
+			}
+		}
+	}
+	else if (sparse[level1] || sparse[level2])
+	{
+		int sparse_level = sparse[level1] ? level1 : level2;
+		int sparse_label = sparse[level1] ? label1 : label2;
+		int dense_level = sparse[level1] ? level2 : level1;
+		int dense_label = sparse[level1] ? label2 : label1;
+
+		const int* bins = entry_bins[sparse_level] + entry_start[sparse_level][sparse_label];
+		const int* counts = entry_counts[sparse_level] + entry_start[sparse_level][sparse_label];
+		const int* dense = histogram[dense_level][dense_label];
+
+		for (int k=0; k<nr_entries[sparse_level][sparse_label]; k++)
+		{
+			intersect += min((float)dense[bins[k]]/T[dense_level][dense_label], (float)counts[k]/T[sparse_level][sparse_label]);
+		}
+	}
+	else
 	{
-		intersect += min((float)histogram[level1][label1][n]/T[level1][label1], (float)histogram[level2][label2][n]/T[level2][label2]);
+		for (int n=0; n<histogram_size; n++)
+		{
+			intersect += min((float)histogram[level1][label1][n]/T[level1][label1], (float)histogram[level2][label2][n]/T[level2][label2]);
+		}
 	}
 
 	return intersect;
@@ -2074,6 +2992,37 @@ bool SEEDS::check_split(int a11, int a12, int a13, int a21, int a22, int a23, in
 	return false;
 }
 
+/**
+ * Returns the number of bytes allocated for the image, the labels and the
+ * histograms, that is the memory used by this instance after initialize.
+ * 
+ * @return 
+ */
+size_t SEEDS::memory_usage()
+{
+	// image_bins, image_l, image_a, image_b, edge_w and edge_h
+	size_t bytes = 6*sizeof(float)*width*height;
+
+	if (initialized)
+	{
+		for (int level=0; level<seeds_nr_levels; level++)
+		{
+			if (labels[level] != NULL) bytes += sizeof(UINT)*width*height;
+			bytes += (2*sizeof(UINT) + sizeof(int))*nr_labels[level];
+			if (sparse[level]) bytes += sizeof(int)*(2*nr_labels[level] + 1 + 2*entry_start[level][nr_labels[level]]);
+			else bytes += sizeof(int)*nr_labels[level]*histogram_size;
+		}
+	}
+
+	bytes += sizeof(float)*(list_channel1.capacity() + list_channel2.capacity() + list_channel3.capacity());
+	bytes += sizeof(int)*(h_boundaries.capacity() + v_boundaries.capacity()) + boundary_flags.capacity();
+	bytes += block_mask.capacity() + changed_blocks.capacity() + sizeof(UINT)*block_labels.capacity();
+	for (unsigned int level=0; level<snapshots.size(); level++) bytes += sizeof(UINT)*snapshots[level].capacity();
+	if (means != NULL) bytes += sizeof(UINT)*width*height;
+
+	return bytes;
+}
+
 int SEEDS::count_superpixels()
 {
 	int* count_labels = new int[nr_labels[seeds_top_level]];
@@ -2131,7 +3080,10 @@ void SEEDS::SaveLabels_CSV(string filename)
 
 void SEEDS::compute_mean_map()
 {
-	means = new UINT[width*height];
+	if (means == NULL)
+	{
+		means = new UINT[width*height];
+	}
 
 	for (int i=0; i<width*height; i++)
 	{
@@ -16,6 +16,7 @@
 #define _SEEDS_H_INCLUDED_
 
 #include <string>
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 using namespace std;
@@ -26,21 +27,49 @@ typedef unsigned int UINT;
 class SEEDS  
 {
 public:
-	SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size);
+	// color spaces used for the histograms
+	enum ColorSpace { LAB, HSV };
+
+	SEEDS(int width, int height, int nr_channels, int nr_bins, int min_size, 
+		ColorSpace colorspace = LAB, bool use_means = false, bool use_prior = true);
 	~SEEDS();
 
+	// free the arrays allocated in initialize
+	void release();
+
 	// initialize with an image
 	void initialize(UINT* image, int seeds_w, int seeds_h, int nr_levels);
 	void initialize(const cv::Mat &image, int seeds_w, int seeds_h, int nr_levels);
+	// initialize with the next frame of a video, keeping the previous superpixels
+	int initialize_next(const cv::Mat &image, float threshold);
+        
+	// choose block size and number of levels for a number of superpixels, see plan
+	static int nr_superpixels(int width, int height, int seeds_w, int seeds_h, int nr_levels);
+	static double predict_runtime(int width, int height, int nr_bins, int iterations, int seeds_w, int seeds_h, int nr_levels);
+	static bool plan(int width, int height, int nr_bins, int iterations, int superpixels, int& seeds_w, int& seeds_h, int& nr_levels);
         
 	// go through iterations
 	void iterate(int iterations);
+	// go through iterations, but stop after the given number of seconds
+	bool iterate(int iterations, double seconds);
+
+	// leave a level early if an iteration moves less blocks/pixels
+	void set_move_thresholds(int min_block_moves, int min_pixel_moves);
+
+	// number of moves of each iteration: block_moves[level][iteration], pixel_moves[iteration]
+	vector< vector<int> > block_moves;
+	vector<int> pixel_moves;
+
+	// keep the segmentation after the block updates at each level, see go_down_one_level
+	void set_snapshots(bool enabled);
+	bool get_snapshot(int level, UINT* snapshot_labels);
 
 	// output labels
 	UINT** labels;	 
 
 	// evaluation
 	int count_superpixels();
+	size_t memory_usage();
 	void SaveLabels_Text(string filename);
         void SaveLabels_CSV(string filename);
         
@@ -53,6 +82,39 @@ private:
 	int current_nr_superpixels;
 	bool initialized;
 
+	// variant of the algorithm, see the constructor
+	ColorSpace colorspace;
+	bool use_means;
+	bool use_prior;
+
+	// video: only blocks with block_mask set (level 0) are updated, see initialize_next
+	bool masked;
+	vector<unsigned char> block_mask;
+	vector<unsigned char> changed_blocks;
+	vector<float> row_l;
+	vector<float> row_a;
+	vector<float> row_b;
+	vector<UINT> row_bins;
+
+	// superpixel of each block at level 0, see update_labels
+	vector<UINT> block_labels;
+
+	// boundary pixels visited by update_pixels, see add_boundaries
+	bool boundaries_valid;
+	vector<unsigned char> boundary_flags;
+	vector<int> h_boundaries;
+	vector<int> v_boundaries;
+	int h_sorted;
+	int v_sorted;
+
+	// superpixel of each block at level 0 after the block updates at each level
+	bool take_snapshots;
+	vector< vector<UINT> > snapshots;
+
+	// thresholds for early stopping, see set_move_thresholds
+	int min_block_moves;
+	int min_pixel_moves;
+
 	// seeds	
 	int seeds_w;
 	int seeds_h;
@@ -70,6 +132,9 @@ private:
 	float* bin_cutoff1;
 	float* bin_cutoff2;
 	float* bin_cutoff3;
+	vector<float> list_channel1;
+	vector<float> list_channel2;
+	vector<float> list_channel3;
 
 	// keep one labeling for each level
 	UINT* nr_labels;
@@ -82,10 +147,12 @@ private:
 	void assign_labels();
 	void compute_histograms(int until_level = -1);
 	void compute_histograms_ex();
+	int block_label(int level, int label);
+	int block_parent(int level, int label);
 	void compute_means();
 	void compute_edges();
 	void lab_get_histogram_cutoff_values(UINT* image);
-	void lab_get_histogram_cutoff_values(const cv::Mat &image);
+	void lab_get_histogram_cutoff_values();
         
 	// color conversion and histograms
 	int RGB2HSV(const int& r, const int& g, const int& b, float* hval, float* sval, float* vval);
@@ -94,16 +161,34 @@ private:
 	int RGB2LAB_special(int r, int g, int b, float* lval, float* aval, float* bval);
 	int RGB2LAB_special(int r, int g, int b, int* bin_l, int* bin_a, int* bin_b);
 	void LAB2RGB(float L, float a, float b, int* R, int* G, int* B);
+	void RGB2LAB_row(const unsigned char* row, int channels, float* lval, float* aval, float* bval);
+	void LAB2bin_row(float* lval, float* aval, float* bval, UINT* bins);
 
 	int histogram_size;
 	int*** histogram;
 	//int** subhistogram;
+
+	// levels with small blocks keep their histograms as lists of bins and counts
+	// sorted by bin instead of histogram[level], see compute_histograms
+	bool* sparse;
+	int** entry_start;
+	int** nr_entries;
+	int** entry_bins;
+	int** entry_counts;
+	void clear_histograms();
+	void add_entry(int level, int label, int bin, int count);
+	void merge_entries(int level, int label, int sublevel, int sublabel, int sign);
 	
 
-    void update(int level, int label_new, int x, int y);
+	template<bool MEANS>
+	void update(int level, int label_new, int x, int y);
+	void add_boundaries(int x, int y);
+	void prepare_boundaries(bool horizontal);
 	void add_pixel(int level, int label, int x, int y);
+	template<bool MEANS>
 	void add_pixel_m(int level, int label, int x, int y);
 	void delete_pixel(int level, int label, int x, int y);
+	template<bool MEANS>
 	void delete_pixel_m(int level, int label, int x, int y);
 	void add_block(int level, int label, int sublevel, int sublabel);
 	void delete_block(int level, int label, int sublevel, int sublabel);
@@ -111,30 +196,37 @@ private:
 
 
 	// probability computation
-	bool probability(int color, int label1, int label2, int prior1, int prior2, float edge1, float edge2);
-	bool probability_means(float L, float a, float b, int label1, int label2, int prior1, int prior2, float edge1, float edge2);
+	template<bool MEANS, bool PRIOR>
+	bool probability(int index, int label1, int label2, int prior1, int prior2, float edge1, float edge2);
 
 	int threebythree(int x, int y, int label);
-	int threebyfour(int x, int y, int label);
-	int fourbythree(int x, int y, int lacompute_mean_mapbel);
 
 
 	// block updating
-	void update_blocks(int level, float req_confidence = 0.0);
+	int update_blocks(int level, float req_confidence = 0.0);
 	float merge_threshold;
 	float intersection(int level1, int label1, int level2, int label2);
 	float geometric_distance(int label1, int label2);
 	int min_size;
 
 	// border updating
-	void update_pixels();
-	void update_pixels_means();
+	int update_pixels();
+	template<bool MEANS, bool PRIOR>
+	int update_pixels();
 	bool forwardbackward;
 	int threebythree_upperbound;
 	int threebythree_lowerbound;
 
 	bool check_split(int a11, int a12, int a13, int a21, int a22, int a23, int a31, int a32, int a33, bool horizontal, bool forward);
 
+	// topology lookup, indexed by the mask of labels equal to a given label
+	// in the three by four (horizontal) or four by three (vertical) window
+	enum { PRIOR_COUNT = 15, SPLIT_FIRST = 16, SPLIT_SECOND = 32 };
+	unsigned char topology_h[4096];
+	unsigned char topology_v[4096];
+	void build_topology();
+	void window_masks(const UINT* window, int stride, bool horizontal, int labelA, int labelB, int& maskA, int& maskB);
+
 	int nr_comp;
 	float step_h;
 	float step_w;
@@ -155,7 +247,6 @@ private:
 	float* B_subchannel;
 	int width, height, nr_channels, nr_bins;
 
-	int iteration;
 	int step;
 };
 
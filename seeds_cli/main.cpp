@@ -24,6 +24,27 @@
  *                          positional argument)
  *   --bins arg (=5)        number of bins
  *   --iterations arg (=2)  iterations at each level
+ *   --deadline arg         time budget per image in milliseconds, the current
+ *                          segmentation is used when the budget is exhausted
+ *   --block-moves arg (=0) leave a block level early if an iteration moves less
+ *                          blocks
+ *   --pixel-moves arg (=0) stop the pixel updates early if an iteration moves
+ *                          less pixels
+ *   --video                treat the images as consecutive frames of a video and
+ *                          only update the superpixels where the frames changed,
+ *                          labels are kept consistent over frames
+ *   --change-threshold arg (=0.02)
+ *                          minimum change of a color channel (in [0,1]) for a 
+ *                          pixel to be considered changed in video mode
+ *   --hsv                  use the HSV instead of the Lab color space (faster
+ *                          but less accurate)
+ *   --means                include the mean colors of the superpixels in the 
+ *                          pixel updates
+ *   --no-prior             do not use the boundary length prior in the pixel 
+ *                          updates
+ *   --superpixels arg      number of superpixels for any image size, the 
+ *                          configuration with the lowest predicted runtime is 
+ *                          chosen
  *   --bsd arg              number of superpixels for BSDS500
  *   --nyucropped arg       number of superpixels for the cropped NYU Depth V2
  *   --nyuhalf arg          number of superpixel for NYU Depth V2 halfed
@@ -33,6 +54,10 @@
  *                          directory
  *   --process              show additional information while processing
  *   --csv                  save segmentation as CSV file
+ *   --hierarchy            save the segmentation after the block updates at each
+ *                          level as CSV files (name_level<level>.csv) from the 
+ *                          same run, all with the same number of superpixels and
+ *                          only finer boundaries at lower levels
  *   --contour              save contour image of segmentation
  *   --mean                 save mean colored image of segmentation
  *   --output arg (=output) specify the output directory (default is ./output)
@@ -73,6 +98,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/timer.hpp>
 #include <boost/program_options.hpp>
+#include <boost/lexical_cast.hpp>
 
 #if defined(WIN32) || defined(_WIN32)
     #define DIRECTORY_SEPARATOR "\\"
@@ -88,6 +114,15 @@ int main(int argc, const char** argv) {
         ("input", boost::program_options::value<std::string>(), "the folder to process (can also be passed as positional argument)")
         ("bins", boost::program_options::value<int>()->default_value(5), "number of bins")
         ("iterations", boost::program_options::value<int>()->default_value(2), "iterations at each level")
+        ("deadline", boost::program_options::value<double>(), "time budget per image in milliseconds, the current segmentation is used when the budget is exhausted")
+        ("block-moves", boost::program_options::value<int>()->default_value(0), "leave a block level early if an iteration moves less blocks")
+        ("pixel-moves", boost::program_options::value<int>()->default_value(0), "stop the pixel updates early if an iteration moves less pixels")
+        ("video", "treat the images as consecutive frames of a video and only update the superpixels where the frames changed, labels are kept consistent over frames")
+        ("change-threshold", boost::program_options::value<float>()->default_value(0.02f), "minimum change of a color channel (in [0,1]) for a pixel to be considered changed in video mode")
+        ("hsv", "use the HSV instead of the Lab color space (faster but less accurate)")
+        ("means", "include the mean colors of the superpixels in the pixel updates")
+        ("no-prior", "do not use the boundary length prior in the pixel updates")
+        ("superpixels", boost::program_options::value<int>(), "number of superpixels for any image size, the configuration with the lowest predicted runtime is chosen")
         ("bsd", boost::program_options::value<int>(), "number of superpixels for BSDS500")
         ("nyucropped", boost::program_options::value<int>(), "number of superpixels for the cropped NYU Depth V2")
         ("nyuhalf", boost::program_options::value<int>(), "number of superpixel for NYU Depth V2 halfed")
@@ -95,6 +130,7 @@ int main(int argc, const char** argv) {
         ("time", boost::program_options::value<std::string>(), "time the algorithm and save results to the given directory")
         ("process", "show additional information while processing")
         ("csv", "save segmentation as CSV file")
+        ("hierarchy", "save the segmentation after the block updates at each level as CSV files (name_level<level>.csv) from the same run, all with the same number of superpixels and only finer boundaries at lower levels")
         ("contour", "save contour image of segmentation")
         ("mean", "save mean colored image of segmentation")
         ("output", boost::program_options::value<std::string>()->default_value("output"), "specify the output directory (default is ./output)");
@@ -160,17 +196,53 @@ int main(int argc, const char** argv) {
     
     int iterations = parameters["iterations"].as<int>();
     int bins = parameters["bins"].as<int>();
+    int blockMoves = parameters["block-moves"].as<int>();
+    int pixelMoves = parameters["pixel-moves"].as<int>();
+    
+    bool video = false;
+    if (parameters.find("video") != parameters.end()) {
+        video = true;
+    }
+    float changeThreshold = parameters["change-threshold"].as<float>();
+    
+    SEEDS::ColorSpace colorspace = SEEDS::LAB;
+    if (parameters.find("hsv") != parameters.end()) {
+        colorspace = SEEDS::HSV;
+    }
+    
+    bool means = false;
+    if (parameters.find("means") != parameters.end()) {
+        means = true;
+    }
+    
+    bool prior = true;
+    if (parameters.find("no-prior") != parameters.end()) {
+        prior = false;
+    }
+    
+    bool hierarchy = false;
+    if (parameters.find("hierarchy") != parameters.end()) {
+        hierarchy = true;
+    }
     
     boost::timer timer;
     double totalTime = 0;
     
     cv::Mat time(images.size(), 2, cv::DataType<double>::type);
+    
+    // SEEDS is reused for consecutive images of the same size such that
+    // all buffers are only allocated once.
+    SEEDS* seeds = NULL;
+    int seedsCols = 0;
+    int seedsRows = 0;
+    int seedsChannels = 0;
+    
     for(std::vector<boost::filesystem::path>::iterator iterator = images.begin(); iterator != images.end(); ++iterator) {
         cv::Mat image = cv::imread(iterator->string());
 
-        int levels = 4;
-        int width = 3;
-        int height = 4;
+        int levels = 0;
+        int width = 0;
+        int height = 0;
 
         if (parameters.find("bsd") != parameters.end()) {
             int bsd = parameters["bsd"].as<int>();
@@ -617,30 +689,106 @@ int main(int argc, const char** argv) {
                     break;
             }
         }
+        
+        // Any other number of superpixels (--superpixels or numbers not covered by
+        // the tables above) is planned using the cost model of SEEDS::plan.
+        if (levels == 0) {
+            int superpixels = 0;
+            const char* options[] = {"superpixels", "bsd", "nyucropped", "nyuhalf", "nyuhalfcropped"};
+            for (int i = 0; i < 5 && superpixels == 0; ++i) {
+                if (parameters.find(options[i]) != parameters.end()) {
+                    superpixels = parameters[options[i]].as<int>();
+                }
+            }
+            
+            if (superpixels <= 0 || !SEEDS::plan(image.cols, image.rows, bins, iterations, superpixels, width, height, levels)) {
+                levels = 4;
+                width = 3;
+                height = 4;
+            }
+        }
+        
+        if (process == true) {
+            std::cout << "Configuration for " << iterator->string() << ": " << levels << " levels, blocks of " << width << "x" << height << " pixels, "
+                    << SEEDS::nr_superpixels(image.cols, image.rows, width, height, levels) << " superpixels" << std::endl;
+        }
 
-        SEEDS seeds(image.cols, image.rows, image.channels(), bins, 0);
+        // In video mode, the superpixels of the previous frame are reused.
+        bool next = video;
+        
+        if (seeds == NULL || image.cols != seedsCols || image.rows != seedsRows || image.channels() != seedsChannels) {
+            delete seeds;
+            next = false;
+            
+            seeds = new SEEDS(image.cols, image.rows, image.channels(), bins, 0, colorspace, means, prior);
+            seedsCols = image.cols;
+            seedsRows = image.rows;
+            seedsChannels = image.channels();
+            
+            seeds->set_move_thresholds(blockMoves, pixelMoves);
+            seeds->set_snapshots(hierarchy);
+        }
 
         timer.restart();
         int index = std::distance(images.begin(), iterator);
         
-        seeds.initialize(image, width, height, levels);
-        seeds.iterate(iterations);
+        int changed = -1;
+        if (next == true) {
+            changed = seeds->initialize_next(image, changeThreshold);
+        }
+        else {
+            seeds->initialize(image, width, height, levels);
+        }
+        
+        bool complete = true;
+        if (parameters.find("deadline") != parameters.end()) {
+            complete = seeds->iterate(iterations, parameters["deadline"].as<double>()/1000.0);
+        }
+        else {
+            seeds->iterate(iterations);
+        }
         
         time.at<double>(index, 1) = timer.elapsed();
         time.at<double>(index, 0) = index + 1;
         totalTime += time.at<double>(index, 1);
 
+        if (process == true && changed >= 0) {
+            std::cout << changed << " pixels changed in " << iterator->string() << " ..." << std::endl;
+        }
+        
+        if (process == true && !complete) {
+            std::cout << "Deadline reached for " << iterator->string() << " ..." << std::endl;
+        }
+        
+        if (process == true) {
+            std::cout << "Memory used for " << iterator->string() << ": " << seeds->memory_usage()/1048576.0 << " MB" << std::endl;
+            std::cout << "Moves for " << iterator->string() << ":";
+            for (int level = levels - 1; level >= 0; --level) {
+                for (unsigned int i = 0; i < seeds->block_moves[level].size(); ++i) {
+                    std::cout << (i == 0 ? " | " : " ") << seeds->block_moves[level][i];
+                }
+            }
+            
+            for (unsigned int i = 0; i < seeds->pixel_moves.size(); ++i) {
+                std::cout << (i == 0 ? " | " : " ") << seeds->pixel_moves[i];
+            }
+            std::cout << std::endl;
+        }
+        
         // Convert labels.
         int** labels = new int*[image.rows];
         for (int i = 0; i < image.rows; ++i) {
             labels[i] = new int[image.cols];
 
             for (int j = 0; j < image.cols; ++j) {
-                labels[i][j] = seeds.labels[levels - 1][j + image.cols*i];
+                labels[i][j] = seeds->labels[levels - 1][j + image.cols*i];
             }
         }
 
-        Integrity::relabel(labels, image.rows, image.cols);
+        // Relabeling would destroy the correspondence of labels between frames.
+        if (video == false) {
+            Integrity::relabel(labels, image.rows, image.cols);
+        }
 
         if (parameters.find("contour") != parameters.end()) {
 
@@ -683,12 +831,48 @@ int main(int argc, const char** argv) {
             }
         }
         
+        // The snapshots of all block levels are saved from the same run.
+        if (hierarchy == true) {
+            
+            boost::filesystem::path extension = iterator->extension();
+            int position = iterator->filename().string().find(extension.string());
+            UINT* snapshot = new UINT[image.rows*image.cols];
+            
+            for (int level = levels - 2; level >= 0; --level) {
+                if (!seeds->get_snapshot(level, snapshot)) {
+                    continue;
+                }
+                
+                for (int i = 0; i < image.rows; ++i) {
+                    for (int j = 0; j < image.cols; ++j) {
+                        labels[i][j] = snapshot[j + image.cols*i];
+                    }
+                }
+                
+                if (video == false) {
+                    Integrity::relabel(labels, image.rows, image.cols);
+                }
+                
+                boost::filesystem::path csvFile(outputDir.string() + DIRECTORY_SEPARATOR + iterator->filename().string().substr(0, position) 
+                        + "_level" + boost::lexical_cast<std::string>(level) + ".csv");
+                Export::CSV(labels, image.rows, image.cols, csvFile);
+
+                if (process == true) {
+                    std::cout << "Labels for image " << iterator->string() << " at level " << level << " saved in " << csvFile.string() << " ..." << std::endl;
+                }
+            }
+            
+            delete[] snapshot;
+        }
+        
         for (int i = 0; i < image.rows; ++i) {
             delete[] labels[i];
         }
         delete[] labels;
     }
     
+    delete seeds;
+    
     if (parameters.find("time") != parameters.end()) {
         
         boost::filesystem::path timeDir(parameters["time"].as<std::string>());